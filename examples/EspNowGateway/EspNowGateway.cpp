@@ -0,0 +1,106 @@
+// Mains-powered gateway for the EspNowNode example: acknowledges each report
+// frame and prints its records. Keep it on the channel the nodes use.
+#include <ReportLink.h>
+
+#if defined(ESP32)
+#include <WiFi.h>
+#include <esp_now.h>
+#include <esp_wifi.h>
+#if __has_include(<esp_idf_version.h>)
+#include <esp_idf_version.h>
+#endif
+#elif defined(ESP8266)
+#include <ESP8266WiFi.h>
+#include <espnow.h>
+#endif
+
+const uint8_t CHANNEL = 1;
+
+// Frames are handed from the receive callback to loop()
+uint8_t frame[ESP_LOW_POWER_SENSOR_REPORT_FRAME];
+uint8_t sender[6];
+volatile size_t frameLength = 0;
+
+void handleFrame(const uint8_t* mac, const uint8_t* data, size_t length) {
+  if (frameLength != 0 || length > sizeof(frame)) {
+    return;  // Still busy with the last frame; the node will resend
+  }
+  memcpy(sender, mac, sizeof(sender));
+  memcpy(frame, data, length);
+  frameLength = length;
+}
+
+#if defined(ESP32) && ESP_IDF_VERSION_MAJOR >= 5
+void onReceive(const esp_now_recv_info_t* info, const uint8_t* data, int length) { handleFrame(info->src_addr, data, length); }
+#elif defined(ESP32)
+void onReceive(const uint8_t* mac, const uint8_t* data, int length) { handleFrame(mac, data, length); }
+#elif defined(ESP8266)
+void onReceive(uint8_t* mac, uint8_t* data, uint8_t length) { handleFrame(mac, data, length); }
+#endif
+
+void addPeer(const uint8_t* mac) {
+  #if defined(ESP32)
+  if (!esp_now_is_peer_exist(mac)) {
+    esp_now_peer_info_t peer = {};
+    memcpy(peer.peer_addr, mac, 6);
+    peer.channel = CHANNEL;
+    peer.ifidx = WIFI_IF_STA;
+    esp_now_add_peer(&peer);
+  }
+  #elif defined(ESP8266)
+  if (!esp_now_is_peer_exist(const_cast<uint8_t*>(mac))) {
+    esp_now_add_peer(const_cast<uint8_t*>(mac), ESP_NOW_ROLE_COMBO, CHANNEL, nullptr, 0);
+  }
+  #endif
+}
+
+void setup() {
+  Serial.begin(115200);
+  WiFi.mode(WIFI_STA);
+  #if defined(ESP32)
+  esp_wifi_set_channel(CHANNEL, WIFI_SECOND_CHAN_NONE);
+  #elif defined(ESP8266)
+  wifi_set_channel(CHANNEL);
+  #endif
+  Serial.print("Gateway MAC: ");
+  Serial.println(WiFi.macAddress());
+
+  esp_now_init();
+  #if defined(ESP8266)
+  esp_now_set_self_role(ESP_NOW_ROLE_COMBO);
+  #endif
+  esp_now_register_recv_cb(onReceive);
+}
+
+void loop() {
+  size_t length = frameLength;
+  if (length == 0) {
+    return;
+  }
+
+  uint8_t ack[ReportLink::ACK_SIZE];
+  if (ReportLink::makeAck(frame, length, ack) > 0) {
+    addPeer(sender);
+    esp_now_send(sender, ack, sizeof(ack));
+
+    // A resend after a lost ack is acknowledged again but printed once
+    static uint8_t lastFrame[6] = {};
+    if (memcmp(lastFrame, ack, sizeof(ack)) == 0) {
+      frameLength = 0;
+      return;
+    }
+    memcpy(lastFrame, ack, sizeof(ack));
+
+    const uint8_t* record;
+    size_t recordLength;
+    for (size_t i = 0; ReportLink::readRecord(frame, length, i, record, recordLength); i++) {
+      Serial.printf("node %02x%02x%02x%02x seq %u record %u:", frame[5], frame[4], frame[3], frame[2],
+                    frame[1], static_cast<unsigned>(i));
+      for (size_t j = 0; j < recordLength; j++) {
+        Serial.printf(" %02x", record[j]);
+      }
+      Serial.println();
+    }
+  }
+  frameLength = 0;
+}
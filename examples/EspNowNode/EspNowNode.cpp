@@ -0,0 +1,29 @@
+#include <ESPLowPowerSensor.h>
+#include <EspNowTransport.h>
+
+ESPLowPowerSensor lowPowerSensor;
+
+// Station MAC address of the gateway (printed by the EspNowGateway example)
+const uint8_t gatewayMac[6] = {0x24, 0x6F, 0x28, 0x00, 0x00, 0x01};
+EspNowTransport transport(gatewayMac, 1);
+
+void readAndReport() {
+  uint16_t reading = analogRead(A0);
+  uint8_t payload[2] = {static_cast<uint8_t>(reading), static_cast<uint8_t>(reading >> 8)};
+  lowPowerSensor.report(payload, sizeof(payload));  // Sent with the other reports before sleeping
+}
+
+void setup() {
+  ESPLowPowerSensor::sleepIfIdle();
+  Serial.begin(115200);
+
+  // Reports go to the gateway over ESP-NOW; no access point or credentials needed
+  lowPowerSensor.setTransport(&transport);
+  lowPowerSensor.deferWifiUntilNeeded();
+  lowPowerSensor.initialize(ESPLowPowerSensor::Mode::SINGLE_INTERVAL, true, ESPLowPowerSensor::LowPowerMode::DEEP_SLEEP);
+  lowPowerSensor.addSensor(readAndReport, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 60000);
+}
+
+void loop() {
+  lowPowerSensor.run();
+}
@@ -0,0 +1,211 @@
+#ifndef BENCH_SUITE_H
+#define BENCH_SUITE_H
+
+// Timing benchmarks of the scheduler, dispatch and interrupt paths, shared by
+// the host runner (HostBench.cpp) and the on-device sketch (DeviceBench).
+//
+// Every benchmark reports through an emit(metric, value, unit) callback; the
+// runners print one "metric,value,unit" CSV line per result, which
+// check_baseline.py compares against a stored baseline. All metrics are
+// lower-is-better.
+//
+// Wall-clock time comes from std::chrono on the host and from the 64-bit
+// microsecond timer on the boards. Scheduler time advances through the
+// virtual clock on the host and in real time on the boards.
+
+#include <Arduino.h>
+#include <ESPLowPowerSensor.h>
+
+#if defined(HOST_ARDUINO_H)
+#include <chrono>
+#elif defined(ESP32)
+#include <esp_timer.h>
+#endif
+
+namespace bench {
+
+constexpr size_t SENSOR_COUNTS[] = {1, 16, 128};
+
+/** @brief Monotonic wall-clock time in nanoseconds. */
+inline uint64_t wallNanos() {
+    #if defined(HOST_ARDUINO_H)
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    #elif defined(ESP32)
+    return static_cast<uint64_t>(esp_timer_get_time()) * 1000;
+    #elif defined(ESP8266)
+    return micros64() * 1000;
+    #endif
+}
+
+/** @brief Moves scheduler time on by one millisecond. */
+inline void advanceOneMilli() {
+    #if defined(HOST_ARDUINO_H)
+    host::advanceMicros(1000);
+    #else
+    unsigned long start = millis();
+    while (millis() == start) {
+        yield();
+    }
+    #endif
+}
+
+inline void noop() {}
+
+// Counters are static so each runner that includes this header gets its own.
+static volatile uint32_t dispatchCount = 0;
+
+inline void countDispatch() {
+    dispatchCount = dispatchCount + 1;
+}
+
+/**
+ * @brief Cost of run() when no sensor is due, with sensorCount timed sensors.
+ * @return Nanoseconds per run() call.
+ */
+inline double runIdleNanos(size_t sensorCount, uint32_t calls) {
+    ESPLowPowerSensor lowPowerSensor;
+    lowPowerSensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP);
+    for (size_t i = 0; i < sensorCount; ++i) {
+        lowPowerSensor.addSensor(noop, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 3600000UL + i);
+    }
+    lowPowerSensor.run();  // Runs the sensors that are due on the first call
+
+    uint64_t start = wallNanos();
+    for (uint32_t i = 0; i < calls; ++i) {
+        lowPowerSensor.run();
+    }
+    return static_cast<double>(wallNanos() - start) / calls;
+}
+
+/**
+ * @brief Cost of run() per dispatched sensor, with every sensor due on every millisecond.
+ * @return Nanoseconds of run() time per sensor dispatched.
+ */
+inline double runDispatchNanosPerSensor(size_t sensorCount, uint32_t milliseconds) {
+    ESPLowPowerSensor lowPowerSensor;
+    lowPowerSensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP);
+    for (size_t i = 0; i < sensorCount; ++i) {
+        lowPowerSensor.addSensor(countDispatch, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 1);
+    }
+
+    // Only run() calls that dispatch count, so time spent waiting for the
+    // next millisecond on a board is left out
+    uint64_t busy = 0;
+    dispatchCount = 0;
+    for (uint32_t ms = 0; ms < milliseconds; ++ms) {
+        advanceOneMilli();
+        uint32_t before = dispatchCount;
+        uint64_t start = wallNanos();
+        lowPowerSensor.run();
+        uint64_t elapsed = wallNanos() - start;
+        if (dispatchCount != before) {
+            busy += elapsed;
+        }
+    }
+    return dispatchCount ? static_cast<double>(busy) / dispatchCount : 0;
+}
+
+#if defined(HOST_ARDUINO_H)
+static uint64_t callbackAt = 0;
+
+inline void stampCallback() {
+    callbackAt = wallNanos();
+}
+
+/**
+ * @brief Time from the timer interrupt to the wake function of a due sensor,
+ * through the interrupt queue and the next run().
+ *
+ * The interrupt is the one setupTimerInterrupt() attaches, fired by the host
+ * stand-in of the timer alarm. A board cannot fire its alarm on demand, so
+ * this benchmark only runs on the host.
+ *
+ * @return Nanoseconds from interrupt to callback.
+ */
+inline double isrToCallbackNanos(uint32_t samples) {
+    ESPLowPowerSensor lowPowerSensor;
+    lowPowerSensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP);
+    lowPowerSensor.addSensor(stampCallback, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 1);
+    lowPowerSensor.setupTimerInterrupt(1);
+
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < samples; ++i) {
+        advanceOneMilli();
+        uint64_t raisedAt = wallNanos();
+        host::fireTimer();
+        lowPowerSensor.run();
+        total += callbackAt - raisedAt;
+    }
+    lowPowerSensor.disableInterrupts();
+    return static_cast<double>(total) / samples;
+}
+#endif
+
+/**
+ * @brief Cost of one push and one pop on the interrupt queue.
+ * @return Nanoseconds per push/pop pair.
+ */
+inline double queuePushPopNanos(uint32_t pairs) {
+    CircularBuffer queue;
+    size_t value = 0;
+    volatile size_t sink = 0;
+
+    uint64_t start = wallNanos();
+    for (uint32_t i = 0; i < pairs; ++i) {
+        queue.push(i);
+        queue.pop(value);
+        sink = sink + value;
+    }
+    return static_cast<double>(wallNanos() - start) / pairs;
+}
+
+/**
+ * @brief Cost of computing the time until the next sensor is due.
+ * @return Nanoseconds per getTimeUntilNextSensor() call.
+ */
+inline double nextWakeNanos(size_t sensorCount, uint32_t calls) {
+    ESPLowPowerSensor lowPowerSensor;
+    lowPowerSensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP);
+    for (size_t i = 0; i < sensorCount; ++i) {
+        lowPowerSensor.addSensor(noop, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 1000 + (i * 7919) % 9000);
+    }
+
+    unsigned long remaining = 0;
+    volatile unsigned long sink = 0;
+    uint64_t start = wallNanos();
+    for (uint32_t i = 0; i < calls; ++i) {
+        lowPowerSensor.getTimeUntilNextSensor(remaining);
+        sink = sink + remaining;
+    }
+    return static_cast<double>(wallNanos() - start) / calls;
+}
+
+/**
+ * @brief Runs every benchmark that does not need a reset between samples.
+ * @param emit Called as emit(metric, value, unit) for each result.
+ */
+template <typename Emit>
+void runAll(Emit emit) {
+    char metric[48];
+    for (size_t count : SENSOR_COUNTS) {
+        snprintf(metric, sizeof(metric), "run_idle_%u", static_cast<unsigned>(count));
+        emit(metric, runIdleNanos(count, 2000), "ns");
+    }
+    for (size_t count : SENSOR_COUNTS) {
+        snprintf(metric, sizeof(metric), "run_dispatch_per_sensor_%u", static_cast<unsigned>(count));
+        emit(metric, runDispatchNanosPerSensor(count, 200), "ns");
+    }
+    #if defined(HOST_ARDUINO_H)
+    emit("isr_to_callback", isrToCallbackNanos(200), "ns");
+    #endif
+    emit("queue_push_pop", queuePushPopNanos(100000), "ns");
+    for (size_t count : SENSOR_COUNTS) {
+        snprintf(metric, sizeof(metric), "next_wake_%u", static_cast<unsigned>(count));
+        emit(metric, nextWakeNanos(count, 10000), "ns");
+    }
+}
+
+} // namespace bench
+
+#endif // BENCH_SUITE_H
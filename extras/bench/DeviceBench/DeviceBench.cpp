@@ -0,0 +1,87 @@
+// On-device runner for the timing benchmarks in BenchSuite.h.
+//
+// Build with the library and extras/bench on the include path, e.g.
+//   pio ci --lib="." --board=esp32dev --project-option="build_flags=-I$PWD/extras/bench" extras/bench/DeviceBench
+// then capture the serial log. No board baseline is kept in the repository;
+// record one from a known-good build and compare later runs with it:
+//   python3 extras/bench/check_baseline.py serial.log esp32dev.csv --update
+//   python3 extras/bench/check_baseline.py serial.log esp32dev.csv --tolerance 0.2
+//
+// After power-on the sketch prints the suite results as "metric,value,unit"
+// CSV. On ESP32 it then runs WAKES deep-sleep wakes and reports the time
+// from the start of setup() to the start of deep sleep, read from the RTC
+// timer against the sleep start FastWake records. Boot ROM and bootloader
+// time before setup() is not included.
+
+#include <BenchSuite.h>
+
+namespace {
+
+constexpr uint32_t WAKES = 10;
+constexpr unsigned long CYCLE_MS = 1000;
+constexpr size_t WAKE_SENSORS = 4;
+
+#if defined(ESP32)
+RTC_DATA_ATTR uint32_t wakeCount = 0;     // Timer wakes so far
+RTC_DATA_ATTR uint64_t wakeStartUs = 0;   // RTC time at the start of setup() on the last wake
+RTC_DATA_ATTR uint64_t wakeTotalUs = 0;
+#endif
+
+ESPLowPowerSensor lowPowerSensor;
+bool finished = false;
+
+void emit(const char* metric, double value, const char* unit) {
+    Serial.printf("%s,%.2f,%s\n", metric, value, unit);
+}
+
+} // namespace
+
+void setup() {
+    #if defined(ESP32)
+    uint64_t setupStartUs = FastWake::rtcMicros();
+    #endif
+
+    Serial.begin(115200);
+
+    #if defined(ESP32)
+    if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER) {
+        // FastWake recorded when the last wake went to sleep
+        FastWake::State state;
+        unsigned long remaining;
+        if (wakeCount > 0 && FastWake::load(state, remaining)) {
+            wakeTotalUs += state.sleepStartUs - wakeStartUs;
+        }
+        if (wakeCount == WAKES) {
+            emit("wake_to_sleep", static_cast<double>(wakeTotalUs) / WAKES, "us");
+            Serial.println("done");
+            finished = true;
+            return;
+        }
+        wakeCount++;
+        wakeStartUs = setupStartUs;
+    } else {
+        delay(2000);  // Time to open the serial monitor
+        Serial.println("metric,value,unit");
+        bench::runAll(emit);
+        wakeCount = 0;
+        wakeTotalUs = 0;
+    }
+
+    lowPowerSensor.initialize(ESPLowPowerSensor::Mode::SINGLE_INTERVAL, false, ESPLowPowerSensor::LowPowerMode::DEEP_SLEEP);
+    for (size_t i = 0; i < WAKE_SENSORS; ++i) {
+        lowPowerSensor.addSensor(bench::countDispatch, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, CYCLE_MS);
+    }
+    #else
+    delay(2000);  // Time to open the serial monitor
+    Serial.println("metric,value,unit");
+    bench::runAll(emit);
+    Serial.println("done");
+    finished = true;
+    #endif
+}
+
+void loop() {
+    if (!finished) {
+        lowPowerSensor.run();
+    }
+}
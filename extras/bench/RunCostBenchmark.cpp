@@ -0,0 +1,110 @@
+// Host benchmark of ESPLowPowerSensor::run() cost versus sensor count.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -DESP32 -DESP_LOW_POWER_SENSOR_MAX_SENSORS=1024 -Iextras/host -Isrc
+//       src/*.cpp extras/host/HostArduino.cpp extras/bench/RunCostBenchmark.cpp -o run_cost_bench
+//   ./run_cost_bench
+//
+// Each sensor gets a different interval between 1 s and 10 s. The virtual
+// clock advances 1 ms per run() for one simulated minute, and the wall-clock
+// time of run() is reported per call. The "linear" column runs the same
+// schedule through a per-run O(n) scan over array-of-struct sensors, which is
+// how run() worked before the SensorRegistry, for comparison.
+
+#include <Arduino.h>
+#include <ESPLowPowerSensor.h>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+namespace {
+
+constexpr unsigned long SIMULATED_MS = 60000;
+
+volatile unsigned long dispatchCount = 0;
+
+void countDispatch() {
+    dispatchCount = dispatchCount + 1;
+}
+
+unsigned long intervalFor(size_t i) {
+    return 1000 + (i * 7919) % 9000;
+}
+
+double benchRegistry(size_t sensorCount, unsigned long& dispatches) {
+    host::setTime(0);
+    ESPLowPowerSensor lowPowerSensor;
+    lowPowerSensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP);
+    for (size_t i = 0; i < sensorCount; ++i) {
+        lowPowerSensor.addSensor(countDispatch, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, intervalFor(i));
+    }
+
+    dispatchCount = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long t = 0; t < SIMULATED_MS; ++t) {
+        lowPowerSensor.run();
+        host::advanceMicros(1000);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    dispatches = dispatchCount;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / SIMULATED_MS;
+}
+
+struct LinearSensor {
+    std::function<void()> wakeFunction;
+    std::function<void()> sleepFunction;
+    unsigned long interval;
+    unsigned long lastExecutionTime;
+};
+
+double benchLinear(size_t sensorCount, unsigned long& dispatches) {
+    host::setTime(0);
+    std::vector<LinearSensor> sensors(sensorCount);
+    for (size_t i = 0; i < sensorCount; ++i) {
+        sensors[i] = {countDispatch, nullptr, intervalFor(i), 0};
+    }
+
+    dispatchCount = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long t = 0; t < SIMULATED_MS; ++t) {
+        unsigned long currentTime = millis();
+        for (auto& sensor : sensors) {
+            if (currentTime - sensor.lastExecutionTime >= sensor.interval) {
+                sensor.wakeFunction();
+                if (sensor.sleepFunction) {
+                    sensor.sleepFunction();
+                }
+                sensor.lastExecutionTime = millis();
+            }
+        }
+        host::advanceMicros(1000);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    dispatches = dispatchCount;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / SIMULATED_MS;
+}
+
+} // namespace
+
+int main() {
+    const size_t counts[] = {1, 10, 50, 100, 250, 500, 1000};
+
+    printf("sensors,registry_ns_per_run,linear_ns_per_run,dispatches\n");
+    for (size_t count : counts) {
+        if (count > MAX_SENSORS) {
+            break;
+        }
+        unsigned long registryDispatches = 0;
+        unsigned long linearDispatches = 0;
+        double registryNs = benchRegistry(count, registryDispatches);
+        double linearNs = benchLinear(count, linearDispatches);
+        if (registryDispatches != linearDispatches) {
+            fprintf(stderr, "dispatch mismatch at %zu sensors: %lu vs %lu\n",
+                    count, registryDispatches, linearDispatches);
+            return 1;
+        }
+        printf("%zu,%.1f,%.1f,%lu\n", count, registryNs, linearNs, registryDispatches);
+    }
+    return 0;
+}
@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+"""Compare benchmark results against a stored baseline.
+
+Reads "metric,value,unit" CSV lines from the host runner or from the serial
+log of the DeviceBench sketch (other lines are ignored) and fails if any
+metric is slower than its baseline by more than the tolerance. All metrics
+are lower-is-better.
+
+Usage:
+    check_baseline.py RESULTS BASELINE [--tolerance 1.0] [--scaling] [--update]
+
+--tolerance 1.0 (the default) allows results up to twice the baseline, which
+leaves room for noise on shared machines and still catches a hot path that
+has become a linear scan. Use a tighter tolerance on a dedicated board.
+--scaling compares how each sized metric (name_N) grows with N instead of
+absolute times: every name_N is divided by the smallest size of the same name,
+and only those ratios can fail. Absolute times are still printed. Use it where
+the machine differs from the one that recorded the baseline, such as CI.
+--update writes the results as the new baseline instead of comparing.
+"""
+
+import argparse
+import re
+import sys
+
+
+def read_results(path):
+    results = {}
+    with open(path, encoding="utf-8", errors="replace") as f:
+        for line in f:
+            fields = line.strip().split(",")
+            if len(fields) != 3:
+                continue
+            metric, value, unit = fields
+            try:
+                results[metric] = (float(value), unit)
+            except ValueError:
+                continue  # Header or unrelated serial output
+    return results
+
+
+def write_baseline(path, results):
+    with open(path, "w", encoding="utf-8") as f:
+        f.write("metric,value,unit\n")
+        for metric, (value, unit) in results.items():
+            f.write(f"{metric},{value:.2f},{unit}\n")
+
+
+def scaling_ratios(results):
+    """Divides each name_N metric by the smallest N of the same name."""
+    sizes = {}
+    for metric in results:
+        match = re.fullmatch(r"(.+)_(\d+)", metric)
+        if match:
+            sizes.setdefault(match.group(1), []).append(int(match.group(2)))
+
+    ratios = {}
+    for name, counts in sizes.items():
+        smallest = min(counts)
+        reference = results[f"{name}_{smallest}"][0]
+        for count in counts:
+            if count != smallest and reference:
+                ratios[f"{name}_{count}/{smallest}"] = (results[f"{name}_{count}"][0] / reference, "x")
+    return ratios
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("results")
+    parser.add_argument("baseline")
+    parser.add_argument("--tolerance", type=float, default=1.0,
+                        help="allowed slowdown as a fraction of the baseline")
+    parser.add_argument("--scaling", action="store_true",
+                        help="fail only on sized metrics growing faster with size than in the baseline")
+    parser.add_argument("--update", action="store_true",
+                        help="write the results as the new baseline")
+    args = parser.parse_args()
+
+    results = read_results(args.results)
+    if not results:
+        print(f"no results found in {args.results}", file=sys.stderr)
+        return 1
+
+    if args.update:
+        write_baseline(args.baseline, results)
+        print(f"wrote {len(results)} metrics to {args.baseline}")
+        return 0
+
+    baseline = read_results(args.baseline)
+    if args.scaling:
+        print_table(baseline, results, None)
+        print()
+        return 1 if print_table(scaling_ratios(baseline), scaling_ratios(results), args.tolerance) else 0
+    return 1 if print_table(baseline, results, args.tolerance) else 0
+
+
+def print_table(baseline, results, tolerance):
+    """Prints results next to the baseline; with a tolerance, flags and returns regressions."""
+    failed = False
+    print(f"{'metric':<32}{'baseline':>12}{'result':>12}{'change':>9}")
+    for metric, (expected, unit) in baseline.items():
+        if metric not in results:
+            print(f"{metric:<32}{expected:>10.2f}{unit:<2}{'missing':>12}")
+            failed |= tolerance is not None
+            continue
+        value, _ = results[metric]
+        change = (value - expected) / expected if expected else 0.0
+        regressed = tolerance is not None and value > expected * (1 + tolerance)
+        failed |= regressed
+        print(f"{metric:<32}{expected:>10.2f}{unit:<2}{value:>10.2f}{unit:<2}{change:>+8.0%}"
+              f"{'  REGRESSION' if regressed else ''}")
+
+    for metric in results.keys() - baseline.keys():
+        print(f"{metric:<32}{'(new)':>12}{results[metric][0]:>10.2f}{results[metric][1]:<2}")
+    return failed
+
+
+if __name__ == "__main__":
+    sys.exit(main())
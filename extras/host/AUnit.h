@@ -0,0 +1,89 @@
+#ifndef HOST_AUNIT_H
+#define HOST_AUNIT_H
+
+// Minimal stand-in for the AUnit test library, so the test sketch in tests/
+// builds and runs on a Linux host against the Arduino stand-in. Only what the
+// sketch uses is provided: test(), assertTrue(), assertFalse(), assertEqual()
+// and aunit::TestRunner. See HostTests.cpp for the runner.
+
+#include <Arduino.h>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace aunit {
+
+class TestRunner {
+public:
+    using TestFunction = void (*)(bool& failed);
+
+    /** @brief Registers a test; called by the test() macro before main(). */
+    static bool add(const char* name, TestFunction function) {
+        tests().push_back({name, function, false});
+        return true;
+    }
+
+    /** @brief Leaves a test out of run(). */
+    static void exclude(const char* name) {
+        for (Test& test : tests()) {
+            if (strcmp(test.name, name) == 0) {
+                test.excluded = true;
+            }
+        }
+    }
+
+    /**
+     * @brief Runs every test that is not excluded, in the order they were defined.
+     * @return The number of failed tests.
+     */
+    static int run() {
+        int passed = 0, failed = 0, skipped = 0;
+        for (const Test& test : tests()) {
+            if (test.excluded) {
+                printf("Test %s skipped.\n", test.name);
+                skipped++;
+                continue;
+            }
+            bool testFailed = false;
+            test.function(testFailed);
+            printf("Test %s %s.\n", test.name, testFailed ? "failed" : "passed");
+            (testFailed ? failed : passed)++;
+        }
+        printf("TestRunner summary: %d passed, %d failed, %d skipped, out of %zu test(s).\n",
+               passed, failed, skipped, tests().size());
+        return failed;
+    }
+
+private:
+    struct Test {
+        const char* name;
+        TestFunction function;
+        bool excluded;
+    };
+
+    static std::vector<Test>& tests() {
+        static std::vector<Test> registered;
+        return registered;
+    }
+};
+
+} // namespace aunit
+
+#define test(name) \
+    static void aunitTest_##name(bool& aunitFailed); \
+    static const bool aunitRegistered_##name = aunit::TestRunner::add(#name, aunitTest_##name); \
+    static void aunitTest_##name(bool& aunitFailed)
+
+#define assertTrue(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("Assertion failed: %s, file %s, line %d.\n", #condition, __FILE__, __LINE__); \
+            aunitFailed = true; \
+            return; \
+        } \
+    } while (0)
+
+#define assertFalse(condition) assertTrue(!(condition))
+#define assertEqual(expected, actual) assertTrue((expected) == (actual))
+
+#endif // HOST_AUNIT_H
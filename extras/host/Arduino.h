@@ -0,0 +1,162 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Minimal Arduino/ESP32 stand-in used to build the library on a Linux host for
+// tests, benchmarks and simulations. Time is virtual: millis()/micros() only
+// advance through delay(), sleep calls and host::advanceMicros(), which keeps
+// runs deterministic and independent of the machine they run on.
+//
+// Build with -DESP32 -Iextras/host -Isrc and link extras/host/HostArduino.cpp.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define A0 36
+
+namespace host {
+    uint64_t nowMicros();
+    void advanceMicros(uint64_t us);
+    void setTime(uint64_t us);
+
+    /** @brief Pin levels returned by digitalRead()/analogRead(). */
+    void setPin(uint8_t pin, int value);
+
+    /** @brief When false (the default), Serial output is discarded. */
+    extern bool serialEcho;
+}
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+int analogRead(uint8_t pin);
+uint32_t analogReadMilliVolts(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+
+class String : public std::string {
+public:
+    using std::string::string;
+    String(const std::string& s) : std::string(s) {}
+    String(int v) : std::string(std::to_string(v)) {}
+    String(unsigned long v) : std::string(std::to_string(v)) {}
+};
+
+class Print {
+public:
+    virtual ~Print() = default;
+    virtual size_t write(const uint8_t* buffer, size_t size) = 0;
+
+    size_t print(const char* text) { return write(reinterpret_cast<const uint8_t*>(text), strlen(text)); }
+    size_t print(unsigned long value) { return print(std::to_string(value).c_str()); }
+    size_t println(const char* text) { return print(text) + print("\n"); }
+    size_t println(unsigned long value) { return print(value) + print("\n"); }
+};
+
+class HardwareSerial : public Print {
+public:
+    size_t write(const uint8_t* buffer, size_t size) override {
+        if (host::serialEcho) {
+            std::cout.write(reinterpret_cast<const char*>(buffer), size);
+        }
+        return size;
+    }
+
+    void begin(unsigned long) {}
+    explicit operator bool() const { return true; }
+
+    template <typename T>
+    size_t print(const T& value) {
+        if (host::serialEcho) {
+            std::cout << value;
+        }
+        return 0;
+    }
+
+    template <typename T>
+    size_t println(const T& value) {
+        if (host::serialEcho) {
+            std::cout << value << '\n';
+        }
+        return 0;
+    }
+
+    size_t println() { return println(""); }
+
+    template <typename... Args>
+    size_t printf(const char* format, Args... args) {
+        return host::serialEcho ? std::printf(format, args...) : 0;
+    }
+};
+
+extern HardwareSerial Serial;
+
+// ESP32 chip identity and random numbers
+class EspClass {
+public:
+    uint64_t getEfuseMac();
+};
+
+extern EspClass ESP;
+
+/** @brief Deterministic on the host, so runs repeat exactly. */
+uint32_t esp_random();
+
+namespace host {
+    void setMac(uint64_t mac);
+}
+
+// ESP32 hardware timer
+struct hw_timer_t {
+    void (*isr)();
+    uint64_t alarm;
+    bool enabled;
+};
+
+hw_timer_t* timerBegin(uint8_t num, uint16_t divider, bool countUp);
+void timerAttachInterrupt(hw_timer_t* timer, void (*isr)(), bool edge);
+void timerDetachInterrupt(hw_timer_t* timer);
+void timerAlarmWrite(hw_timer_t* timer, uint64_t alarm, bool autoreload);
+void timerAlarmEnable(hw_timer_t* timer);
+void timerAlarmDisable(hw_timer_t* timer);
+void timerEnd(hw_timer_t* timer);
+
+namespace host {
+    /** @brief Runs the interrupt attached to the hardware timer, as its alarm would. */
+    void fireTimer();
+}
+
+// ESP32 sleep. Deep sleep cannot reset the host process, so it returns after
+// advancing the clock; callers treat the return as the next wake.
+typedef enum {
+    ESP_SLEEP_WAKEUP_UNDEFINED = 0,
+    ESP_SLEEP_WAKEUP_EXT0 = 2,
+    ESP_SLEEP_WAKEUP_EXT1 = 3,
+    ESP_SLEEP_WAKEUP_TIMER = 4
+} esp_sleep_wakeup_cause_t;
+
+namespace host {
+    void setWakeupCause(esp_sleep_wakeup_cause_t cause);
+}
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause();
+int esp_sleep_enable_timer_wakeup(uint64_t us);
+void esp_deep_sleep_start();
+int esp_light_sleep_start();
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,118 @@
+#include "Arduino.h"
+#include "WiFi.h"
+#include <map>
+
+HardwareSerial Serial;
+WiFiClass WiFi;
+EspClass ESP;
+
+namespace {
+    uint64_t clockMicros = 0;
+    uint64_t sleepTimerMicros = 0;
+    esp_sleep_wakeup_cause_t wakeupCause = ESP_SLEEP_WAKEUP_UNDEFINED;
+    std::map<uint8_t, int> pinLevels;
+    hw_timer_t timer0 = {nullptr, 0, false};
+    uint64_t efuseMac = 0x24A160123456ULL;
+    uint32_t randomState = 2463534242u;
+}
+
+namespace host {
+    bool serialEcho = false;
+
+    uint64_t nowMicros() { return clockMicros; }
+    void advanceMicros(uint64_t us) { clockMicros += us; }
+    void setTime(uint64_t us) { clockMicros = us; }
+    void setPin(uint8_t pin, int value) { pinLevels[pin] = value; }
+    void setWakeupCause(esp_sleep_wakeup_cause_t cause) { wakeupCause = cause; }
+    void setMac(uint64_t mac) { efuseMac = mac; }
+}
+
+uint64_t EspClass::getEfuseMac() { return efuseMac; }
+
+uint32_t esp_random() {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+unsigned long millis() { return static_cast<unsigned long>(clockMicros / 1000); }
+unsigned long micros() { return static_cast<unsigned long>(clockMicros); }
+void delay(unsigned long ms) { clockMicros += static_cast<uint64_t>(ms) * 1000; }
+void delayMicroseconds(unsigned int us) { clockMicros += us; }
+void yield() {}
+
+void pinMode(uint8_t, uint8_t) {}
+int digitalRead(uint8_t pin) { return pinLevels[pin]; }
+void digitalWrite(uint8_t pin, uint8_t value) { pinLevels[pin] = value; }
+int analogRead(uint8_t pin) { return pinLevels[pin]; }
+uint32_t analogReadMilliVolts(uint8_t pin) { return pinLevels[pin]; }
+void analogWrite(uint8_t pin, int value) { pinLevels[pin] = value; }
+
+hw_timer_t* timerBegin(uint8_t, uint16_t, bool) { return &timer0; }
+void timerAttachInterrupt(hw_timer_t* timer, void (*isr)(), bool) { timer->isr = isr; }
+void timerDetachInterrupt(hw_timer_t* timer) { timer->isr = nullptr; }
+void timerAlarmWrite(hw_timer_t* timer, uint64_t alarm, bool) { timer->alarm = alarm; }
+void timerAlarmEnable(hw_timer_t* timer) { timer->enabled = true; }
+void timerAlarmDisable(hw_timer_t* timer) { timer->enabled = false; }
+void timerEnd(hw_timer_t* timer) { *timer = {nullptr, 0, false}; }
+
+namespace host {
+    void fireTimer() {
+        if (timer0.enabled && timer0.isr != nullptr) {
+            timer0.isr();
+        }
+    }
+}
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() {
+    return wakeupCause;
+}
+
+int esp_sleep_enable_timer_wakeup(uint64_t us) {
+    sleepTimerMicros = us;
+    return 0;
+}
+
+void esp_deep_sleep_start() {
+    WiFi.disconnect(true);
+    clockMicros += sleepTimerMicros;
+    wakeupCause = ESP_SLEEP_WAKEUP_TIMER;
+}
+
+int esp_light_sleep_start() {
+    clockMicros += sleepTimerMicros;
+    return 0;
+}
+
+wl_status_t WiFiClass::begin(const char*, const char*) {
+    return begin();
+}
+
+wl_status_t WiFiClass::begin() {
+    ++beginCount;
+    if (!_radioOn) {
+        _radioOn = true;
+        _beginAt = clockMicros;
+    }
+    return status();
+}
+
+bool WiFiClass::disconnect(bool) {
+    if (_radioOn) {
+        _radioOnTotal += clockMicros - _beginAt;
+        _radioOn = false;
+    }
+    return true;
+}
+
+wl_status_t WiFiClass::status() {
+    if (!_radioOn || failConnect) {
+        return WL_DISCONNECTED;
+    }
+    return clockMicros - _beginAt >= static_cast<uint64_t>(connectDelayMs) * 1000 ? WL_CONNECTED : WL_IDLE_STATUS;
+}
+
+uint64_t WiFiClass::radioOnMicros() const {
+    return _radioOnTotal + (_radioOn ? clockMicros - _beginAt : 0);
+}
@@ -0,0 +1,49 @@
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+#include "Arduino.h"
+
+typedef enum {
+    WIFI_OFF = 0,
+    WIFI_STA = 1
+} wifi_mode_t;
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+/**
+ * @class WiFiClass
+ * @brief Host stand-in for the ESP32 WiFi object.
+ *
+ * Association completes connectDelayMs of virtual time after begin(); the
+ * status() poll loop in the library advances the clock through delay().
+ */
+class WiFiClass {
+public:
+    unsigned long connectDelayMs = 0;   ///< Virtual association + DHCP time
+    bool failConnect = false;           ///< Never reach WL_CONNECTED when set
+    unsigned long beginCount = 0;       ///< Number of begin() calls
+
+    bool mode(wifi_mode_t m) { _mode = m; return true; }
+    wl_status_t begin(const char* ssid, const char* password);
+    wl_status_t begin();
+    bool disconnect(bool wifiOff = false);
+    wl_status_t status();
+
+    /** @brief Total virtual time the radio has been on, in microseconds. */
+    uint64_t radioOnMicros() const;
+
+private:
+    wifi_mode_t _mode = WIFI_OFF;
+    bool _radioOn = false;
+    uint64_t _beginAt = 0;
+    uint64_t _radioOnTotal = 0;
+};
+
+extern WiFiClass WiFi;
+
+#endif // HOST_WIFI_H
@@ -0,0 +1,28 @@
+#ifndef HOST_ESP_NOW_H
+#define HOST_ESP_NOW_H
+
+#include "esp_wifi.h"
+
+/**
+ * Host stand-in for ESP-NOW: frames are accepted and go nowhere, so nothing
+ * is ever received. LoopbackTransport is the host transport with a gateway.
+ */
+typedef struct {
+    uint8_t peer_addr[6];
+    uint8_t lmk[16];
+    uint8_t channel;
+    wifi_interface_t ifidx;
+    bool encrypt;
+    void* priv;
+} esp_now_peer_info_t;
+
+typedef void (*esp_now_recv_cb_t)(const uint8_t* mac, const uint8_t* data, int length);
+
+inline esp_err_t esp_now_init() { return ESP_OK; }
+inline esp_err_t esp_now_deinit() { return ESP_OK; }
+inline bool esp_now_is_peer_exist(const uint8_t*) { return false; }
+inline esp_err_t esp_now_add_peer(const esp_now_peer_info_t*) { return ESP_OK; }
+inline esp_err_t esp_now_send(const uint8_t*, const uint8_t*, size_t) { return ESP_OK; }
+inline esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t) { return ESP_OK; }
+
+#endif // HOST_ESP_NOW_H
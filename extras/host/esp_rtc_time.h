@@ -0,0 +1,9 @@
+#ifndef HOST_ESP_RTC_TIME_H
+#define HOST_ESP_RTC_TIME_H
+
+#include "Arduino.h"
+
+/** @brief RTC time; on the host this is the virtual clock. */
+inline uint64_t esp_rtc_get_time_us() { return host::nowMicros(); }
+
+#endif // HOST_ESP_RTC_TIME_H
@@ -0,0 +1,176 @@
+// Host simulation of node lifetime under the battery degradation policy.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -DESP32 -Iextras/host -Isrc
+//       src/*.cpp extras/host/HostArduino.cpp extras/sim/BatteryLifetimeSim.cpp -o battery_sim
+//   ./battery_sim
+//
+// A SINGLE_INTERVAL deep-sleep node runs the real library against the virtual
+// clock while a single Li-ion cell discharges along a typical open-circuit
+// voltage curve. Each cycle the battery voltage is fed to the ADC pin, and the
+// charge used while awake (boot, sensor conversions, uplink) and asleep is
+// subtracted from the cell. The node dies when the cell reaches the brownout
+// voltage. The same node is replayed with the policy disabled, with the
+// library defaults and with a more aggressive policy.
+
+#include <Arduino.h>
+#include <ESPLowPowerSensor.h>
+#include <cstdio>
+
+namespace {
+
+// Cell
+constexpr double CAPACITY_MAH = 2000.0;
+constexpr uint16_t BROWNOUT_MV = 3100;
+
+// Node
+constexpr uint8_t BATTERY_PIN = 34;
+constexpr float DIVIDER_RATIO = 2.0f;
+constexpr unsigned long CYCLE_MS = 60000;
+constexpr double BOOT_MS = 250.0;          // Boot and setup() on every deep-sleep wake
+constexpr double AWAKE_MA = 40.0;          // CPU running, radio off
+constexpr double SLEEP_MA = 0.010;         // Deep sleep including regulator quiescent current
+constexpr unsigned long SENSOR_MS = 50;    // Required sensors, each
+constexpr unsigned long OPTIONAL_MS = 400; // Heated gas sensor
+constexpr double OPTIONAL_MA = 60.0;
+constexpr unsigned long UPLINK_MS = 2500;  // Association, DHCP and transmission
+constexpr double UPLINK_MA = 130.0;
+
+constexpr double SIMULATED_DAYS_MAX = 5 * 365.0;
+
+// Open-circuit voltage of a Li-ion cell by state of charge (percent)
+const double OCV_CURVE[][2] = {
+    {100, 4200}, {90, 4060}, {80, 3980}, {70, 3920}, {60, 3870}, {50, 3830},
+    {40, 3790}, {30, 3750}, {20, 3700}, {10, 3600}, {5, 3450}, {2, 3300}, {0, 3000}
+};
+
+uint16_t cellMillivolts(double stateOfCharge) {
+    const size_t points = sizeof(OCV_CURVE) / sizeof(OCV_CURVE[0]);
+    for (size_t i = 1; i < points; ++i) {
+        if (stateOfCharge >= OCV_CURVE[i][0]) {
+            double span = OCV_CURVE[i - 1][0] - OCV_CURVE[i][0];
+            double t = (stateOfCharge - OCV_CURVE[i][0]) / span;
+            return static_cast<uint16_t>(OCV_CURVE[i][1] + t * (OCV_CURVE[i - 1][1] - OCV_CURVE[i][1]));
+        }
+    }
+    return static_cast<uint16_t>(OCV_CURVE[points - 1][1]);
+}
+
+double chargeMah(double milliseconds, double milliamps) {
+    return milliseconds * milliamps / 3600000.0;
+}
+
+struct Result {
+    double days;
+    unsigned long readings;
+    unsigned long optionalReadings;
+    unsigned long uplinks;
+    double daysInTier[BatteryPolicy::TIER_COUNT];
+};
+
+// Charge and time used by callbacks during the current cycle
+double cycleCharge = 0;
+double cycleAwakeMs = 0;
+unsigned long readings = 0;
+unsigned long optionalReadings = 0;
+unsigned long uplinks = 0;
+
+void runFor(unsigned long ms, double milliamps) {
+    delay(ms);
+    cycleAwakeMs += ms;
+    cycleCharge += chargeMah(ms, milliamps);
+}
+
+Result simulate(bool policyEnabled, const BatteryPolicy::Config& config) {
+    Result result = {};
+    readings = optionalReadings = uplinks = 0;
+    host::setTime(0);
+    host::setWakeupCause(ESP_SLEEP_WAKEUP_UNDEFINED);
+
+    ESPLowPowerSensor node;
+    node.initialize(ESPLowPowerSensor::Mode::SINGLE_INTERVAL, false, ESPLowPowerSensor::LowPowerMode::DEEP_SLEEP);
+    node.addSensor([]() { runFor(SENSOR_MS, AWAKE_MA); readings++; }, nullptr,
+                   ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, CYCLE_MS);
+    node.addSensor([]() { runFor(SENSOR_MS, AWAKE_MA); readings++; }, nullptr,
+                   ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, CYCLE_MS);
+
+    ESPLowPowerSensor::SensorId optionalId;
+    node.addSensor([]() { runFor(OPTIONAL_MS, OPTIONAL_MA); optionalReadings++; }, nullptr,
+                   ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, CYCLE_MS, 0, &optionalId);
+    node.setSensorOptional(optionalId, true);
+
+    // The uplink sensor sends everything collected since the last uplink
+    ESPLowPowerSensor* nodePtr = &node;
+    node.addSensor([nodePtr]() {
+        if (nodePtr->isUplinkDue()) {
+            runFor(UPLINK_MS, UPLINK_MA);
+            uplinks++;
+        }
+    }, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, CYCLE_MS);
+    node.setHeartbeatFunction([]() { runFor(UPLINK_MS, UPLINK_MA); uplinks++; });
+
+    if (policyEnabled) {
+        node.enableBatteryPolicy(BATTERY_PIN, DIVIDER_RATIO, config);
+    }
+
+    // Start the clock at one cycle so the first run() executes the sensors
+    host::setTime(static_cast<uint64_t>(CYCLE_MS) * 1000);
+    double remainingMah = CAPACITY_MAH;
+    const double maxMicros = SIMULATED_DAYS_MAX * 86400.0 * 1e6;
+
+    while (host::nowMicros() < maxMicros) {
+        uint16_t millivolts = cellMillivolts(100.0 * remainingMah / CAPACITY_MAH);
+        if (millivolts <= BROWNOUT_MV) {
+            break;
+        }
+        host::setPin(BATTERY_PIN, static_cast<int>(millivolts / DIVIDER_RATIO));
+
+        BatteryPolicy::Tier tier = node.getBatteryTier();
+        uint64_t start = host::nowMicros();
+        cycleCharge = chargeMah(BOOT_MS, AWAKE_MA);
+        cycleAwakeMs = 0;
+        node.run();
+
+        // Only callbacks and goToSleep() move the virtual clock, so whatever
+        // the callbacks did not use was spent asleep
+        double elapsedMs = (host::nowMicros() - start) / 1000.0;
+        cycleCharge += chargeMah(elapsedMs - cycleAwakeMs, SLEEP_MA);
+
+        remainingMah -= cycleCharge;
+        result.daysInTier[static_cast<size_t>(tier)] += (elapsedMs + BOOT_MS) / 86400000.0;
+        host::advanceMicros(static_cast<uint64_t>(BOOT_MS * 1000));
+    }
+
+    result.days = host::nowMicros() / 86400e6;
+    result.readings = readings;
+    result.optionalReadings = optionalReadings;
+    result.uplinks = uplinks;
+    return result;
+}
+
+void report(const char* name, const Result& result) {
+    printf("%s,%.1f,%lu,%lu,%lu,%.1f,%.1f,%.1f,%.1f\n", name, result.days, result.readings,
+           result.optionalReadings, result.uplinks, result.daysInTier[0], result.daysInTier[1],
+           result.daysInTier[2], result.daysInTier[3]);
+}
+
+} // namespace
+
+int main() {
+    BatteryPolicy::Config defaults = BatteryPolicy::liIonDefaults();
+    defaults.sampleInterval = 0;
+
+    // Degrade earlier and batch harder
+    BatteryPolicy::Config aggressive = defaults;
+    aggressive.tiers[1] = {3800, 2, false, 4};
+    aggressive.tiers[2] = {3700, 5, true, 10};
+    aggressive.tiers[3] = {3500, 1, true, 1};
+    aggressive.heartbeatInterval = 6 * 3600000UL;
+
+    printf("policy,lifetime_days,readings,optional_readings,uplinks,"
+           "days_normal,days_stretch,days_conserve,days_hibernate\n");
+    report("disabled", simulate(false, defaults));
+    report("defaults", simulate(true, defaults));
+    report("aggressive", simulate(true, aggressive));
+    return 0;
+}
@@ -0,0 +1,105 @@
+// Host simulation of awake time per SINGLE_INTERVAL cycle, serial vs pipelined.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -DESP32 -Iextras/host -Isrc
+//       src/*.cpp extras/host/HostArduino.cpp extras/sim/PipelineSim.cpp -o pipeline_sim
+//   ./pipeline_sim
+//
+// A deep-sleep node runs the real library against the virtual clock: every
+// wake boots, runs setup() (a new ESPLowPowerSensor and initialize()) and one
+// run(). The sensors only sample; the uplink function sends. In the serial
+// flow initialize() waits for WiFi before any sensor runs, as the library
+// always did. In the pipelined flow the cycle starts association and samples
+// while the access point answers. Awake time runs from the start of boot to
+// the deep-sleep request; radio time is what the WiFi stand-in was on.
+// uplink_calls counts calls of the uplink function in the serial and
+// pipelined flows, which should both be one per cycle.
+
+#include <Arduino.h>
+#include <ESPLowPowerSensor.h>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+constexpr unsigned long CYCLE_MS = 60000;
+constexpr unsigned long CYCLES = 20;
+constexpr unsigned long BOOT_MS = 250;         // Boot before setup() on every deep-sleep wake
+constexpr unsigned long ASSOCIATION_MS = 2500; // Association and DHCP
+constexpr unsigned long TRANSMIT_MS = 150;     // Each call of the uplink function
+
+struct Workload {
+    const char* name;
+    std::vector<unsigned long> conversionMs;   // One sensor each
+};
+
+struct Result {
+    double awakeMs;
+    double radioMs;
+    unsigned long uplinks;
+};
+
+unsigned long uplinks = 0;  // Calls of the uplink function
+
+Result simulate(const Workload& workload, bool pipelined) {
+    // Start the clock at one cycle so the first run() executes the sensors
+    host::setTime(CYCLE_MS * 1000ULL);
+    host::setWakeupCause(ESP_SLEEP_WAKEUP_UNDEFINED);
+    WiFi.connectDelayMs = ASSOCIATION_MS;
+    WiFi.disconnect(true);
+    uplinks = 0;
+
+    uint64_t awakeMicros = 0;
+    uint64_t radioStart = WiFi.radioOnMicros();
+    for (unsigned long cycle = 0; cycle < CYCLES; ++cycle) {
+        uint64_t wake = host::nowMicros();
+        host::advanceMicros(BOOT_MS * 1000ULL);
+
+        // setup()
+        ESPLowPowerSensor node;
+        node.setWiFiCredentials("ssid", "password");
+        if (pipelined) {
+            node.enablePipelining();
+        }
+        node.initialize(ESPLowPowerSensor::Mode::SINGLE_INTERVAL, true, ESPLowPowerSensor::LowPowerMode::DEEP_SLEEP);
+        for (unsigned long conversion : workload.conversionMs) {
+            node.addSensor([conversion]() { delay(conversion); }, nullptr,
+                           ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, CYCLE_MS);
+        }
+        node.setUplinkFunction([]() { delay(TRANSMIT_MS); uplinks++; });
+
+        // loop()
+        node.run();
+
+        // Deep sleep does not return on a device; the stand-in returns after
+        // the sleep, so take the requested sleep back off and reboot the radio
+        awakeMicros += host::nowMicros() - wake - CYCLE_MS * 1000ULL;
+        WiFi.disconnect(true);
+    }
+
+    Result result;
+    result.awakeMs = awakeMicros / 1000.0 / CYCLES;
+    result.radioMs = (WiFi.radioOnMicros() - radioStart) / 1000.0 / CYCLES;
+    result.uplinks = uplinks;
+    return result;
+}
+
+} // namespace
+
+int main() {
+    const Workload workloads[] = {
+        {"fast", {20, 20}},                 // I2C temperature and pressure
+        {"temperature", {750, 50}},         // 12-bit DS18B20 conversion and a humidity sensor
+        {"particulate", {3000, 50}},        // Particulate sensor fan spin-up and a humidity sensor
+    };
+
+    printf("workload,serial_awake_ms,pipelined_awake_ms,saved_percent,serial_radio_ms,pipelined_radio_ms,uplink_calls\n");
+    for (const Workload& workload : workloads) {
+        Result serial = simulate(workload, false);
+        Result pipelined = simulate(workload, true);
+        printf("%s,%.0f,%.0f,%.0f,%.0f,%.0f,%lu/%lu\n", workload.name, serial.awakeMs, pipelined.awakeMs,
+               100.0 * (serial.awakeMs - pipelined.awakeMs) / serial.awakeMs, serial.radioMs, pipelined.radioMs,
+               serial.uplinks, pipelined.uplinks);
+    }
+    return 0;
+}
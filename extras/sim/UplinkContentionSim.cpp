@@ -0,0 +1,213 @@
+// Host simulation of many nodes associating with one access point.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -DESP32 -Iextras/host -Isrc
+//       src/UplinkSchedule.cpp extras/sim/UplinkContentionSim.cpp -o uplink_sim
+//   ./uplink_sim
+//
+// N nodes power up together and run one SINGLE_INTERVAL cycle per minute for
+// a day, each ending in an uplink. The access point serves associations one at
+// a time, so nodes associating together share its time, and every extra
+// contender wastes some of it in collisions. An attempt that runs past its
+// timeout is dropped and its progress lost. Each node's crystal runs slightly
+// fast or slow, which moves its slot against the others over the day.
+//
+// The nodes are modelled rather than run through ESPLowPowerSensor because the
+// WiFi connection blocks the caller; the slots, jitter and backoff come from
+// the same UplinkSchedule the library uses, with the same parameters.
+// Scenarios:
+//   legacy      all nodes aligned, one 10 s attempt (the default connection)
+//   backoff     aligned, three 3 s attempts with backoff but no slots or jitter
+//   staggered   slots from hashed ids and jitter (enableUplinkStagger()), one 10 s attempt
+//   slotted     as staggered, with nodes numbered 0 to N - 1 and slotCount = N
+//   unanchored  as slotted, but each period starts at the jittered wake instead
+//               of the slot, so the jitter adds up and the slots walk
+// contended_percent is the share of cycles whose association shared the access
+// point with another node at some point.
+
+#include <UplinkSchedule.h>
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+constexpr unsigned long CYCLE_MS = 60000;
+constexpr unsigned long SIMULATED_MS = 1440 * CYCLE_MS;
+constexpr double ASSOCIATION_MS = 250.0;    // Access point time for one association, alone
+constexpr double COLLISION_COST = 0.05;     // Share of airtime lost per extra contender
+constexpr unsigned long TRANSMIT_MS = 100;  // Payload and acknowledgement once associated
+constexpr unsigned long BOOT_SPREAD_MS = 50;
+constexpr int DRIFT_PPM = 40;               // Crystal tolerance, either way
+
+enum class State { ASLEEP, ASSOCIATING, BACKOFF, TRANSMITTING };
+
+struct Node {
+    UplinkSchedule schedule;
+    State state;
+    double slotAt;              // Slot the current or next cycle belongs to
+    unsigned long wakeAt;       // Start of the current or next cycle, the slot plus jitter
+    unsigned long stateUntil;   // End of a backoff or transmission
+    unsigned long attemptStart;
+    double associationLeft;     // Access point time still needed, ms
+    uint8_t attempt;
+    bool contended;             // Whether another node associated at the same time this cycle
+    double driftFactor;
+};
+
+struct Result {
+    unsigned long cycles;
+    unsigned long uplinks;
+    unsigned long radioOnMs;
+    unsigned long contendedCycles;
+    std::vector<unsigned long> connectMs;
+};
+
+struct Scenario {
+    const char* name;
+    bool staggered;
+    bool numberedIds;
+    bool anchored;
+    UplinkSchedule::Config config;
+};
+
+Result simulate(const Scenario& scenario, size_t nodeCount) {
+    std::vector<Node> nodes(nodeCount);
+    for (size_t i = 0; i < nodeCount; ++i) {
+        Node& node = nodes[i];
+        node.schedule.setConfig(scenario.config);
+        uint32_t mac = 0x60123456u + static_cast<uint32_t>(i);  // Consecutive MACs from one batch
+        node.schedule.setNodeId(scenario.numberedIds ? static_cast<uint32_t>(i) : UplinkSchedule::mix(mac));
+        node.schedule.seed(UplinkSchedule::mix(mac * 7919u));
+
+        // Power-on together, up to a few ms apart; staggered nodes then wait for their slot
+        node.state = State::ASLEEP;
+        node.slotAt = UplinkSchedule::mix(mac) % BOOT_SPREAD_MS;
+        if (scenario.staggered) {
+            node.slotAt += node.schedule.slotOffset(CYCLE_MS);
+        }
+        node.wakeAt = static_cast<unsigned long>(node.slotAt);
+        node.driftFactor = 1.0 + (static_cast<int>(UplinkSchedule::mix(mac ^ 0xD1F7u) % (2 * DRIFT_PPM + 1)) - DRIFT_PPM) * 1e-6;
+    }
+
+    Result result = {};
+    auto endCycle = [&](Node& node, unsigned long now, bool delivered) {
+        result.cycles++;
+        if (delivered) {
+            result.uplinks++;
+        }
+        if (node.contended) {
+            result.contendedCycles++;
+        }
+        // The node's own clock times the period from the slot, or from the
+        // jittered wake before cycles were anchored to the slot
+        node.slotAt = (scenario.anchored ? node.slotAt : node.wakeAt) + CYCLE_MS * node.driftFactor;
+        unsigned long jitter = scenario.staggered ? node.schedule.cycleJitter(CYCLE_MS) : 0;
+        node.state = State::ASLEEP;
+        node.wakeAt = std::max(now, static_cast<unsigned long>(node.slotAt + jitter * node.driftFactor));
+    };
+    auto startAttempt = [](Node& node, unsigned long now) {
+        node.state = State::ASSOCIATING;
+        node.attemptStart = now;
+        node.associationLeft = ASSOCIATION_MS;
+    };
+
+    for (unsigned long now = 0; now < SIMULATED_MS; ++now) {
+        // Skip ahead while every node sleeps
+        unsigned long nextWake = SIMULATED_MS;
+        for (const Node& node : nodes) {
+            nextWake = node.state == State::ASLEEP ? std::min(nextWake, node.wakeAt) : now;
+            if (nextWake == now) {
+                break;
+            }
+        }
+        now = std::max(now, nextWake);
+        if (now >= SIMULATED_MS) {
+            break;
+        }
+
+        size_t contenders = 0;
+        for (const Node& node : nodes) {
+            if (node.state == State::ASSOCIATING) {
+                contenders++;
+            }
+        }
+        double share = contenders ? 1.0 / (contenders * (1.0 + COLLISION_COST * (contenders - 1))) : 0;
+
+        for (Node& node : nodes) {
+            switch (node.state) {
+            case State::ASLEEP:
+                if (now >= node.wakeAt) {
+                    node.attempt = 0;
+                    node.contended = false;
+                    startAttempt(node, now);
+                }
+                break;
+            case State::ASSOCIATING:
+                result.radioOnMs++;
+                node.contended |= contenders > 1;
+                node.associationLeft -= share;
+                if (node.associationLeft <= 0) {
+                    result.connectMs.push_back(now + 1 - node.wakeAt);
+                    node.state = State::TRANSMITTING;
+                    node.stateUntil = now + TRANSMIT_MS;
+                } else if (now + 1 - node.attemptStart >= scenario.config.attemptTimeoutMs) {
+                    if (node.attempt + 1 >= scenario.config.maxAttempts) {
+                        endCycle(node, now + 1, false);
+                    } else {
+                        node.state = State::BACKOFF;
+                        node.stateUntil = now + 1 + node.schedule.backoffDelay(node.attempt);
+                        node.attempt++;
+                    }
+                }
+                break;
+            case State::BACKOFF:
+                if (now >= node.stateUntil) {
+                    startAttempt(node, now);
+                }
+                break;
+            case State::TRANSMITTING:
+                result.radioOnMs++;
+                if (now + 1 >= node.stateUntil) {
+                    endCycle(node, now + 1, true);
+                }
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+void report(const Scenario& scenario, size_t nodeCount) {
+    Result result = simulate(scenario, nodeCount);
+    unsigned long p95 = 0;
+    if (!result.connectMs.empty()) {
+        std::sort(result.connectMs.begin(), result.connectMs.end());
+        p95 = result.connectMs[(result.connectMs.size() - 1) * 95 / 100];
+    }
+    double cycles = result.cycles ? static_cast<double>(result.cycles) : 1.0;
+    printf("%s,%zu,%.0f,%.1f,%lu,%.1f\n", scenario.name, nodeCount, result.radioOnMs / cycles,
+           100.0 * result.uplinks / cycles, p95, 100.0 * result.contendedCycles / cycles);
+}
+
+} // namespace
+
+int main() {
+    UplinkSchedule::Config backoff = UplinkSchedule::defaults();
+    backoff.jitterPercent = 0;
+    backoff.attemptTimeoutMs = 3000;
+    backoff.maxAttempts = 3;
+
+    UplinkSchedule::Config slotted = UplinkSchedule::defaults();
+
+    printf("scenario,nodes,radio_on_ms_per_cycle,delivered_percent,p95_connect_ms,contended_percent\n");
+    for (size_t nodeCount : {5, 20, 50}) {
+        slotted.slotCount = static_cast<uint16_t>(nodeCount);
+        report({"legacy", false, false, true, UplinkSchedule::defaults()}, nodeCount);
+        report({"backoff", false, false, true, backoff}, nodeCount);
+        report({"staggered", true, false, true, UplinkSchedule::defaults()}, nodeCount);
+        report({"slotted", true, true, true, slotted}, nodeCount);
+        report({"unanchored", true, true, false, slotted}, nodeCount);
+    }
+    return 0;
+}
@@ -0,0 +1,218 @@
+#!/usr/bin/env python3
+"""Convert an ESPLowPowerSensor trace dump into a Chrome trace timeline.
+
+The input is either a serial log containing the output of dumpTrace() (the
+last "TRACE BEGIN" ... "TRACE END" block is used) or the raw bytes from
+TraceRecorder::serialize() sent over the uplink. Open the output in
+chrome://tracing or https://ui.perfetto.dev.
+
+Tracks:
+    power       awake and sleep spans; awake spans list the time no sensor ran
+    wifi        connecting and connected spans
+    sensor N    one span per dispatch of sensor N
+
+A summary of wakes, awake time and dead time is printed to stderr.
+
+Usage:
+    trace_to_chrome.py INPUT [-o trace.json]
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+MAGIC = 0x4C505452
+HEADER = struct.Struct("<IBBH")
+EVENT = struct.Struct("<IBBH")
+
+WAKE, DISPATCH_BEGIN, DISPATCH_END, QUEUE_OVERFLOW, WIFI, SLEEP_LIGHT, SLEEP_DEEP = range(1, 8)
+WIFI_STATES = ["off", "connecting", "connected", "failed"]
+
+WAKE_CAUSES = {
+    1: {0: "power-on/reset", 2: "ext0 pin", 3: "ext1 pins", 4: "timer", 5: "touchpad",
+        6: "ulp", 7: "gpio", 8: "uart"},
+    2: {0: "power-on", 1: "hardware watchdog", 2: "exception", 3: "software watchdog",
+        4: "software restart", 5: "deep-sleep wake", 6: "external reset"},
+}
+
+PID = 1
+TID_POWER = 1
+TID_WIFI = 2
+TID_SENSOR_BASE = 10
+
+
+def read_dump(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) >= 4 and struct.unpack_from("<I", data)[0] == MAGIC:
+        return data
+
+    text = data.decode("utf-8", errors="replace")
+    start = text.rfind("TRACE BEGIN")
+    end = text.find("TRACE END", start)
+    if start < 0 or end < 0:
+        raise ValueError("no TRACE BEGIN ... TRACE END block found")
+    lines = text[start:end].splitlines()[1:]
+    return bytes.fromhex("".join(line.strip() for line in lines))
+
+
+def parse(data):
+    if len(data) < HEADER.size:
+        raise ValueError("truncated trace dump")
+    magic, version, platform, count = HEADER.unpack_from(data)
+    if magic != MAGIC:
+        raise ValueError("not a trace dump")
+    if version != 1:
+        raise ValueError(f"unsupported trace format version {version}")
+    count = min(count, (len(data) - HEADER.size) // EVENT.size)
+    events = [EVENT.unpack_from(data, HEADER.size + i * EVENT.size) for i in range(count)]
+    return platform, events
+
+
+def unwrap(events):
+    """Rebuild 48-bit timestamps from the low 32 bits and the high bits on WAKE events."""
+    # Events before the first wake take its high bits, less the wraps in between
+    high = 0
+    wraps = 0
+    previous = None
+    for time, kind, _, arg16 in events:
+        if previous is not None and time < previous:
+            wraps += 1
+        if kind == WAKE:
+            high = arg16 - wraps
+            break
+        previous = time
+
+    result = []
+    previous = None
+    for time, kind, arg8, arg16 in events:
+        if kind == WAKE:
+            high = arg16
+        elif previous is not None and time < previous:
+            high += 1
+        previous = time
+        result.append(((high << 32) | time, kind, arg8, arg16))
+    return result
+
+
+def span(name, tid, start, end, **args):
+    return {"name": name, "ph": "X", "pid": PID, "tid": tid, "ts": start,
+            "dur": max(end - start, 0), "args": args}
+
+
+def to_chrome(platform, events):
+    causes = WAKE_CAUSES.get(platform, {})
+    trace = []
+    sensors = set()
+    summary = {"wakes": 0, "idle_wakes": 0, "awake_us": 0, "dispatch_us": 0, "sleep_us": 0}
+
+    awake_start = events[0][0] if events else 0
+    awake_args = {}
+    dispatches = []        # (start, end) in the current awake span
+    open_dispatch = {}     # sensor id -> start
+    sleep = None           # (start, name, requested ms)
+    wifi = None            # (start, state)
+
+    def close_awake(end):
+        covered = 0
+        last = awake_start
+        for start, stop in sorted(dispatches):
+            start = max(start, last)
+            if stop > start:
+                covered += stop - start
+                last = stop
+        awake = end - awake_start
+        summary["awake_us"] += awake
+        summary["dispatch_us"] += covered
+        if not dispatches:
+            summary["idle_wakes"] += 1
+        trace.append(span("awake", TID_POWER, awake_start, end,
+                          dead_us=awake - covered, dispatches=len(dispatches), **awake_args))
+
+    for time, kind, arg8, arg16 in events:
+        if kind == WAKE:
+            summary["wakes"] += 1
+            for sensor, start in open_dispatch.items():
+                trace.append(span(f"sensor {sensor} (no end)", TID_SENSOR_BASE + sensor, start, time))
+            open_dispatch.clear()
+            if sleep is not None:
+                start, name, requested = sleep
+                actual = (time - start) / 1000.0
+                summary["sleep_us"] += time - start
+                trace.append(span(name, TID_POWER, start, time, requested_ms=requested,
+                                  actual_ms=round(actual, 3)))
+                sleep = None
+            awake_start = time
+            awake_args = {"cause": causes.get(arg8, str(arg8))}
+            dispatches = []
+        elif kind == DISPATCH_BEGIN:
+            sensors.add(arg16)
+            open_dispatch[arg16] = time
+        elif kind == DISPATCH_END:
+            start = open_dispatch.pop(arg16, None)
+            if start is not None:
+                dispatches.append((start, time))
+                trace.append(span(f"sensor {arg16}", TID_SENSOR_BASE + arg16, start, time))
+        elif kind == QUEUE_OVERFLOW:
+            trace.append({"name": "queue overflow", "ph": "i", "s": "t", "pid": PID,
+                          "tid": TID_POWER, "ts": time, "args": {"sensor": arg16}})
+        elif kind == WIFI:
+            state = WIFI_STATES[arg8] if arg8 < len(WIFI_STATES) else str(arg8)
+            if wifi is not None and wifi[1] in ("connecting", "connected"):
+                trace.append(span(wifi[1], TID_WIFI, wifi[0], time))
+            if state == "failed":
+                trace.append({"name": "connect failed", "ph": "i", "s": "t", "pid": PID,
+                              "tid": TID_WIFI, "ts": time})
+            wifi = (time, state)
+        elif kind in (SLEEP_LIGHT, SLEEP_DEEP):
+            close_awake(time)
+            if wifi is not None and wifi[1] in ("connecting", "connected") and kind == SLEEP_DEEP:
+                trace.append(span(wifi[1], TID_WIFI, wifi[0], time))
+                wifi = None
+            name = "deep sleep" if kind == SLEEP_DEEP else "light sleep"
+            sleep = (time, name, (arg8 << 16) | arg16)
+
+    trace.append({"name": "thread_name", "ph": "M", "pid": PID, "tid": TID_POWER, "args": {"name": "power"}})
+    trace.append({"name": "thread_name", "ph": "M", "pid": PID, "tid": TID_WIFI, "args": {"name": "wifi"}})
+    for sensor in sorted(sensors):
+        trace.append({"name": "thread_name", "ph": "M", "pid": PID, "tid": TID_SENSOR_BASE + sensor,
+                      "args": {"name": f"sensor {sensor}"}})
+    return {"traceEvents": trace, "displayTimeUnit": "ms"}, summary
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", help="serial log or raw trace bytes")
+    parser.add_argument("-o", "--output", help="Chrome trace JSON file (default: stdout)")
+    args = parser.parse_args()
+
+    try:
+        platform, events = parse(read_dump(args.input))
+    except (OSError, ValueError) as error:
+        print(f"{args.input}: {error.strerror if isinstance(error, OSError) else error}", file=sys.stderr)
+        return 1
+
+    chrome, summary = to_chrome(platform, unwrap(events))
+    if args.output:
+        try:
+            with open(args.output, "w", encoding="utf-8") as f:
+                json.dump(chrome, f)
+        except OSError as error:
+            print(f"{args.output}: {error.strerror}", file=sys.stderr)
+            return 1
+    else:
+        json.dump(chrome, sys.stdout)
+        sys.stdout.write("\n")
+
+    awake = summary["awake_us"]
+    dead = awake - summary["dispatch_us"]
+    print(f"{len(events)} events, {summary['wakes']} wakes ({summary['idle_wakes']} with no dispatch), "
+          f"awake {awake / 1000:.1f} ms, dead {dead / 1000:.1f} ms "
+          f"({100.0 * dead / awake if awake else 0:.0f}% of awake), "
+          f"asleep {summary['sleep_us'] / 1e6:.1f} s", file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
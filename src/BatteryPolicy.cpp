@@ -0,0 +1,68 @@
+#include "BatteryPolicy.h"
+
+BatteryPolicy::Config BatteryPolicy::liIonDefaults() {
+    Config config = {
+        {
+            {0,    1, false, 1},   // NORMAL
+            {3600, 2, false, 2},   // STRETCH
+            {3450, 4, true,  6},   // CONSERVE
+            {3300, 1, true,  1}    // HIBERNATE
+        },
+        50,        // hysteresisMillivolts
+        3600000,   // heartbeatInterval: 1 hour
+        60000      // sampleInterval: 1 minute
+    };
+    return config;
+}
+
+BatteryPolicy::BatteryPolicy() : BatteryPolicy(liIonDefaults()) {
+}
+
+BatteryPolicy::BatteryPolicy(const Config& config)
+    : _config(config),
+      _state{static_cast<uint8_t>(Tier::NORMAL), 0, 0, 0} {
+}
+
+BatteryPolicy::Tier BatteryPolicy::update(uint16_t millivolts) {
+    _state.millivolts = millivolts;
+
+    Tier target = tierFor(millivolts);
+    if (target > tier()) {
+        // Degrade as soon as the voltage drops
+        _state.tier = static_cast<uint8_t>(target);
+    } else if (target < tier()) {
+        // Recover only once the voltage clears the threshold by the hysteresis
+        uint16_t margin = _config.hysteresisMillivolts;
+        Tier recovered = tierFor(millivolts > margin ? millivolts - margin : 0);
+        if (recovered < tier()) {
+            _state.tier = static_cast<uint8_t>(recovered);
+        }
+    }
+    return tier();
+}
+
+bool BatteryPolicy::uplinkDue(uint32_t wakesAhead) const {
+    uint8_t every = settings().uplinkEvery;
+    return every <= 1 || (_state.wakeCount + wakesAhead) % every == 0;
+}
+
+unsigned long BatteryPolicy::scaleInterval(unsigned long interval) const {
+    uint8_t scale = settings().intervalScale;
+    return scale > 1 ? interval * scale : interval;
+}
+
+void BatteryPolicy::restore(const State& state) {
+    if (state.tier < TIER_COUNT) {
+        _state = state;
+    }
+}
+
+BatteryPolicy::Tier BatteryPolicy::tierFor(uint16_t millivolts) const {
+    // Tiers are ordered by decreasing threshold; take the deepest one that applies
+    for (size_t i = TIER_COUNT - 1; i > 0; --i) {
+        if (millivolts < _config.tiers[i].enterBelowMillivolts) {
+            return static_cast<Tier>(i);
+        }
+    }
+    return Tier::NORMAL;
+}
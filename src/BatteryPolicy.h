@@ -0,0 +1,123 @@
+#ifndef BATTERY_POLICY_H
+#define BATTERY_POLICY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @class BatteryPolicy
+ * @brief Tiered degradation policy driven by the supply voltage.
+ *
+ * Each supply voltage sample is mapped to a tier. Lower tiers stretch sensor
+ * intervals, suppress sensors marked as optional, batch uplinks over more
+ * wakes and finally hibernate with only a long heartbeat. A tier is entered as
+ * soon as the voltage drops below its threshold, and left only once the
+ * voltage has recovered by the configured hysteresis, so a sagging battery
+ * does not flap between tiers.
+ *
+ * The class holds no hardware state; ESPLowPowerSensor samples the voltage and
+ * keeps the policy state in RTC memory across deep sleep.
+ */
+class BatteryPolicy {
+public:
+    /**
+     * @enum Tier
+     * @brief Degradation tiers, from full service to hibernation.
+     */
+    enum class Tier : uint8_t {
+        NORMAL,     ///< Full sampling and uplink rate
+        STRETCH,    ///< Intervals stretched, uplinks batched
+        CONSERVE,   ///< Optional sensors suppressed, uplinks batched further
+        HIBERNATE   ///< Only the heartbeat runs
+    };
+
+    static constexpr size_t TIER_COUNT = 4;
+
+    /**
+     * @struct TierSettings
+     * @brief What the scheduler does while in a tier.
+     */
+    struct TierSettings {
+        uint16_t enterBelowMillivolts;  ///< Tier applies below this voltage (ignored for NORMAL)
+        uint8_t intervalScale;          ///< Multiplier applied to sensor and single intervals
+        bool suppressOptional;          ///< Skip sensors marked optional
+        uint8_t uplinkEvery;            ///< Bring the uplink up on every Nth wake
+    };
+
+    /**
+     * @struct Config
+     * @brief Policy thresholds and tier behaviour.
+     */
+    struct Config {
+        TierSettings tiers[TIER_COUNT];    ///< Indexed by Tier
+        uint16_t hysteresisMillivolts;     ///< Recovery margin before moving to a better tier
+        unsigned long heartbeatInterval;   ///< Wake interval in HIBERNATE, in milliseconds
+        unsigned long sampleInterval;      ///< Minimum time between voltage samples while awake, in milliseconds
+    };
+
+    /**
+     * @struct State
+     * @brief Policy state kept across deep sleep.
+     */
+    struct State {
+        uint8_t tier;
+        uint8_t reserved;
+        uint16_t millivolts;  ///< Last sampled supply voltage
+        uint32_t wakeCount;   ///< Wakes counted for uplink batching
+    };
+
+    /**
+     * @brief Gets a configuration suited to a single Li-ion/LiPo cell.
+     */
+    static Config liIonDefaults();
+
+    BatteryPolicy();
+    explicit BatteryPolicy(const Config& config);
+
+    /**
+     * @brief Updates the tier from a new supply voltage sample.
+     * @param millivolts The supply voltage in millivolts.
+     * @return The tier in effect after the sample.
+     */
+    Tier update(uint16_t millivolts);
+
+    /**
+     * @brief Counts a wake for uplink batching.
+     */
+    void onWake() { ++_state.wakeCount; }
+
+    /**
+     * @brief Checks if the uplink should be brought up on a wake.
+     * @param wakesAhead Zero for the current wake, one for the next, and so on.
+     * @return True if the wake falls on the current tier's uplink cadence.
+     */
+    bool uplinkDue(uint32_t wakesAhead = 0) const;
+
+    /**
+     * @brief Applies the current tier's interval scale.
+     * @param interval The configured interval in milliseconds.
+     * @return The interval to use in the current tier.
+     */
+    unsigned long scaleInterval(unsigned long interval) const;
+
+    Tier tier() const { return static_cast<Tier>(_state.tier); }
+    const TierSettings& settings() const { return _config.tiers[_state.tier]; }
+    const Config& config() const { return _config; }
+    uint16_t millivolts() const { return _state.millivolts; }
+
+    const State& state() const { return _state; }
+
+    /**
+     * @brief Restores state saved before deep sleep.
+     * @param state The saved state; ignored if it names an unknown tier.
+     */
+    void restore(const State& state);
+
+private:
+    Config _config;
+    State _state;
+
+    Tier tierFor(uint16_t millivolts) const;
+};
+
+#endif // BATTERY_POLICY_H
@@ -1,19 +1,85 @@
 #include <Arduino.h>
 #include "ESPLowPowerSensor.h"
+#include "RtcMemory.h"
 #include <algorithm>
 
-void setup(){}
-void loop(){}
+ESPLowPowerSensor* ESPLowPowerSensor::instance = nullptr;
+
+namespace {
+    constexpr uint32_t POLICY_MAGIC = 0x4C505350;  // "LPSP"
+
+    struct PersistedPolicyState {
+        uint32_t magic;
+        BatteryPolicy::State state;
+        uint32_t reserved;
+    };
+
+    static_assert(sizeof(PersistedPolicyState) <= 4 * RtcMemory::BLOCK_SIZE,
+                  "Battery policy state does not fit its RTC memory blocks");
+
+    uint32_t macId() {
+        #if defined(ESP32)
+        uint64_t mac = ESP.getEfuseMac();
+        return static_cast<uint32_t>(mac ^ (mac >> 32));
+        #elif defined(ESP8266)
+        return ESP.getChipId();
+        #endif
+    }
+
+    uint32_t hardwareRandom() {
+        #if defined(ESP32)
+        return esp_random();
+        #elif defined(ESP8266)
+        return RANDOM_REG32;
+        #endif
+    }
+
+    uint8_t wakeCause() {
+        #if defined(ESP32)
+        return static_cast<uint8_t>(esp_sleep_get_wakeup_cause());
+        #elif defined(ESP8266)
+        return static_cast<uint8_t>(ESP.getResetInfoPtr()->reason);
+        #endif
+    }
+}
 
 ESPLowPowerSensor::ESPLowPowerSensor() 
     : _mode(Mode::SINGLE_INTERVAL), 
       _wifiRequired(false), 
       _lowPowerMode(LowPowerMode::DEEP_SLEEP), 
+      _registry(MAX_SENSORS),
       _singleInterval(0), 
+      _dispatching(INVALID_SENSOR),
+      _dispatchRemoved(false),
       _interruptInProgress(false),
       _interruptsEnabled(true),
-      _sensorCount(0),
+      _interruptOccurred(false),
       _wifiInitialized(false),
+      _wifiSSID(nullptr),
+      _wifiPassword(nullptr),
+      _configRestored(false),
+      _batteryPolicyEnabled(false),
+      _batteryPin(0),
+      _batteryDividerRatio(1.0f),
+      _batterySampled(false),
+      _lastBatterySample(0),
+      _heartbeatPending(true),
+      _wakePin(FastWake::NO_WAKE_PIN),
+      _wakeLevel(false),
+      _wifiDeferred(false),
+      _resumePending(false),
+      _resumeRemaining(0),
+      _uplinkStaggered(false),
+      _cycleJitter(0),
+      _nodeIdSet(false),
+      _slotPending(false),
+      _pipelined(false),
+      _pipelineActive(false),
+      _wifiConnecting(false),
+      _wifiAttempt(0),
+      _wifiAttemptStart(0),
+      _transport(nullptr),
+      _transportActive(false),
       _lastExecutionTime(0) {
     instance = this;
 }
@@ -43,11 +109,36 @@ bool ESPLowPowerSensor::initialize(Mode mode, bool wifiRequired, LowPowerMode lo
         #endif
     }
 
-    // Configure WiFi if required
-    if (_wifiRequired) {
+    TraceRecorder::begin();
+    TraceRecorder::recordWake(wakeCause());
+
+    // After a deep-sleep wake, pick up the schedule from before the sleep
+    FastWake::State wakeState;
+    if (FastWake::load(wakeState, _resumeRemaining)) {
+        _resumePending = true;
+        _cycleJitter = wakeState.slackMs;
+        _heartbeatPending = _resumeRemaining <= ESP_LOW_POWER_SENSOR_WAKE_TOLERANCE_MS;
+    }
+
+    // A fresh start moves the first cycle to this node's transmit slot;
+    // after a deep-sleep wake the resumed schedule already keeps it
+    if (!_nodeIdSet) {
+        _uplink.setNodeId(UplinkSchedule::mix(macId()));
+    }
+    _uplink.seed(hardwareRandom());
+    _slotPending = !_resumePending;
+
+    // A random first sequence number keeps the gateway from taking the first
+    // report after a reset for a resend of the last one
+    _reports.setNodeId(_uplink.nodeId());
+    _reports.setSequence(static_cast<uint8_t>(hardwareRandom()));
+
+    // Configure WiFi if required, unless it is deferred until work is due
+    if (_wifiRequired && !wifiOnDemand()) {
         if (!initializeWifi()) {
             return false;
         }
+        _wifiInitialized = true;
     }
 
     return true; // Return false if any initialization fails
@@ -57,8 +148,9 @@ bool ESPLowPowerSensor::addSensor(std::function<void()> wakeFunction,
                                   std::function<void()> sleepFunction, 
                                   TriggerMode triggerMode, 
                                   unsigned long intervalOrThreshold,
-                                  uint8_t pin) {
-    if (_sensorCount >= MAX_SENSORS) {
+                                  uint8_t pin,
+                                  SensorId* id) {
+    if (_registry.size() >= MAX_SENSORS) {
         Serial.println("Maximum number of sensors reached");
         return false;
     }
@@ -74,7 +166,7 @@ bool ESPLowPowerSensor::addSensor(std::function<void()> wakeFunction,
     }
 
     if (_mode == Mode::SINGLE_INTERVAL) {
-        if (_sensorCount == 0) {
+        if (_registry.size() == 0) {
             _singleInterval = intervalOrThreshold;
         } else if (intervalOrThreshold != _singleInterval) {
             Serial.println("All sensors must have the same interval in SINGLE_INTERVAL mode");
@@ -86,7 +178,6 @@ bool ESPLowPowerSensor::addSensor(std::function<void()> wakeFunction,
     newSensor.wakeFunction = wakeFunction;
     newSensor.sleepFunction = sleepFunction;
     newSensor.triggerMode = triggerMode;
-    newSensor.lastExecutionTime = 0;
     newSensor.pin = pin;
 
     switch (triggerMode) {
@@ -103,11 +194,361 @@ bool ESPLowPowerSensor::addSensor(std::function<void()> wakeFunction,
             break;
     }
 
-    _sensors[_sensorCount++] = newSensor;
+    // Sensors start as if last executed at time zero, so they are due once
+    // their interval has elapsed since boot
+    unsigned long currentTime = millis();
+    unsigned long interval = triggerMode == TriggerMode::TIME_INTERVAL ? intervalOrThreshold : 0;
+    unsigned long firstDue = currentTime >= interval ? currentTime : interval;
+
+    SensorId newId = _registry.add(interval, firstDue, triggerMode != TriggerMode::TIME_INTERVAL);
+    if (newId == INVALID_SENSOR) {
+        Serial.println("Maximum number of sensors reached");
+        return false;
+    }
+
+    if (newId >= _sensors.size()) {
+        _sensors.resize(newId + 1);
+    }
+    _sensors[newId] = std::move(newSensor);
+
+    if (id != nullptr) {
+        *id = newId;
+    }
+    return true;
+}
+
+bool ESPLowPowerSensor::removeSensor(SensorId id) {
+    SensorConfig entry = {id, ConfigAction::REMOVE, 0};
+    return applyConfig(&entry, 1);
+}
+
+bool ESPLowPowerSensor::updateInterval(SensorId id, unsigned long interval) {
+    if (!_registry.contains(id) || _sensors[id].triggerMode != TriggerMode::TIME_INTERVAL) {
+        return false;
+    }
+
+    SensorConfig entry = {id, ConfigAction::SET_VALUE, interval};
+    return applyConfig(&entry, 1);
+}
+
+bool ESPLowPowerSensor::updateThreshold(SensorId id, unsigned long threshold) {
+    if (!_registry.contains(id) || _sensors[id].triggerMode == TriggerMode::TIME_INTERVAL) {
+        return false;
+    }
+
+    SensorConfig entry = {id, ConfigAction::SET_VALUE, threshold};
+    return applyConfig(&entry, 1);
+}
+
+bool ESPLowPowerSensor::setSensorEnabled(SensorId id, bool enabled) {
+    SensorConfig entry = {id, enabled ? ConfigAction::ENABLE : ConfigAction::DISABLE, 0};
+    return applyConfig(&entry, 1);
+}
+
+bool ESPLowPowerSensor::setSingleInterval(unsigned long interval) {
+    SensorConfig entry = {INVALID_SENSOR, ConfigAction::SET_SINGLE_INTERVAL, interval};
+    return applyConfig(&entry, 1);
+}
+
+bool ESPLowPowerSensor::applyConfig(const SensorConfig* entries, size_t count) {
+    if (entries == nullptr && count > 0) {
+        return false;
+    }
+
+    // Replay changes from before the last deep sleep first, so they cannot
+    // later overwrite the newer ones applied here
+    restorePersistedConfig();
+
+    // Validate the whole blob against a copy of the persisted state before
+    // touching anything, so a bad entry leaves the configuration unchanged
+    RtcConfigStore store = _configStore;
+    if (!validateConfig(entries, count, store)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        applyConfigEntry(entries[i]);
+    }
+
+    _configStore = store;
+    _configStore.save();
+    return true;
+}
+
+void ESPLowPowerSensor::clearPersistedConfig() {
+    _configStore.clear();
+}
+
+bool ESPLowPowerSensor::validateConfig(const SensorConfig* entries, size_t count, RtcConfigStore& store) const {
+    for (size_t i = 0; i < count; ++i) {
+        const SensorConfig& entry = entries[i];
+
+        if (entry.action == ConfigAction::SET_SINGLE_INTERVAL) {
+            if (_mode != Mode::SINGLE_INTERVAL || entry.value == 0) {
+                Serial.println("Single interval can only be set to a non-zero value in SINGLE_INTERVAL mode");
+                return false;
+            }
+            store.setSingleInterval(entry.value);
+            continue;
+        }
+
+        bool removedEarlier = false;
+        for (size_t j = 0; j < i; ++j) {
+            if (entries[j].id == entry.id && entries[j].action == ConfigAction::REMOVE) {
+                removedEarlier = true;
+            }
+        }
+        if (!_registry.contains(entry.id) || removedEarlier) {
+            Serial.println("Unknown sensor id in configuration");
+            return false;
+        }
+
+        if (entry.action == ConfigAction::SET_VALUE && _sensors[entry.id].triggerMode == TriggerMode::TIME_INTERVAL) {
+            if (entry.value == 0) {
+                Serial.println("Invalid interval for PER_SENSOR mode");
+                return false;
+            }
+            if (_mode == Mode::SINGLE_INTERVAL) {
+                Serial.println("All sensors must have the same interval in SINGLE_INTERVAL mode");
+                return false;
+            }
+        }
+
+        RtcConfigStore::Record* record = store.recordFor(entry.id);
+        if (record == nullptr) {
+            Serial.println("Too many configuration changes to keep across deep sleep");
+            return false;
+        }
+
+        // A removed id that is configured again was reused by addSensor();
+        // the removal no longer applies to the sensor in that slot
+        if (entry.action != ConfigAction::REMOVE && (record->flags & RtcConfigStore::RECORD_REMOVED)) {
+            record->flags = 0;
+        }
+
+        switch (entry.action) {
+            case ConfigAction::ENABLE:
+                record->flags |= RtcConfigStore::RECORD_HAS_ENABLED | RtcConfigStore::RECORD_ENABLED;
+                break;
+            case ConfigAction::DISABLE:
+                record->flags |= RtcConfigStore::RECORD_HAS_ENABLED;
+                record->flags &= ~RtcConfigStore::RECORD_ENABLED;
+                break;
+            case ConfigAction::SET_VALUE:
+                record->flags |= RtcConfigStore::RECORD_HAS_VALUE;
+                record->value = entry.value;
+                break;
+            case ConfigAction::REMOVE:
+                record->flags = RtcConfigStore::RECORD_REMOVED;
+                break;
+            default:
+                Serial.println("Invalid configuration action");
+                return false;
+        }
+    }
+    return true;
+}
+
+void ESPLowPowerSensor::applyConfigEntry(const SensorConfig& entry) {
+    switch (entry.action) {
+        case ConfigAction::ENABLE:
+        case ConfigAction::DISABLE:
+            _registry.setEnabled(entry.id, entry.action == ConfigAction::ENABLE);
+            break;
+        case ConfigAction::SET_VALUE: {
+            Sensor& sensor = _sensors[entry.id];
+            switch (sensor.triggerMode) {
+                case TriggerMode::TIME_INTERVAL:
+                    sensor.triggerValue.interval = entry.value;
+                    changeInterval(entry.id, entry.value);
+                    break;
+                case TriggerMode::DIGITAL:
+                    sensor.triggerValue.digitalValue = entry.value != 0;
+                    break;
+                case TriggerMode::ANALOG_TRIGGER:
+                    sensor.triggerValue.analogValue = entry.value;
+                    break;
+            }
+            break;
+        }
+        case ConfigAction::REMOVE:
+            _registry.remove(entry.id);
+            if (entry.id == _dispatching) {
+                _dispatchRemoved = true;
+            }
+            // Release the callbacks; the slot may be reused by a later addSensor()
+            _sensors[entry.id] = Sensor();
+            break;
+        case ConfigAction::SET_SINGLE_INTERVAL:
+            _singleInterval = entry.value;
+            for (size_t id = 0; id < _registry.slotCount(); ++id) {
+                if (_registry.contains(id) && _sensors[id].triggerMode == TriggerMode::TIME_INTERVAL) {
+                    _sensors[id].triggerValue.interval = entry.value;
+                    changeInterval(id, entry.value);
+                }
+            }
+            break;
+    }
+}
+
+void ESPLowPowerSensor::restorePersistedConfig() {
+    if (_configRestored) {
+        return;
+    }
+    _configRestored = true;
+
+    if (!_configStore.load()) {
+        return;
+    }
+
+    // Replay each change on its own, skipping any that no longer fit the
+    // sensors the sketch added (e.g. after a firmware update)
+    RtcConfigStore scratch = _configStore;
+    for (size_t i = 0; i < _configStore.size(); ++i) {
+        const RtcConfigStore::Record& record = _configStore.record(i);
+        SensorConfig entries[2];
+        size_t count = 0;
+
+        if (record.flags & RtcConfigStore::RECORD_REMOVED) {
+            entries[count++] = {record.id, ConfigAction::REMOVE, 0};
+        } else {
+            if (record.flags & RtcConfigStore::RECORD_HAS_VALUE) {
+                entries[count++] = {record.id, ConfigAction::SET_VALUE, record.value};
+            }
+            if (record.flags & RtcConfigStore::RECORD_HAS_ENABLED) {
+                bool enabled = record.flags & RtcConfigStore::RECORD_ENABLED;
+                entries[count++] = {record.id, enabled ? ConfigAction::ENABLE : ConfigAction::DISABLE, 0};
+            }
+        }
+
+        for (size_t j = 0; j < count; ++j) {
+            if (validateConfig(&entries[j], 1, scratch)) {
+                applyConfigEntry(entries[j]);
+            }
+        }
+    }
+
+    if (_configStore.singleInterval() != 0) {
+        SensorConfig entry = {INVALID_SENSOR, ConfigAction::SET_SINGLE_INTERVAL, _configStore.singleInterval()};
+        if (validateConfig(&entry, 1, scratch)) {
+            applyConfigEntry(entry);
+        }
+    }
+}
+
+void ESPLowPowerSensor::sleepIfIdle() {
+    FastWake::State state;
+    unsigned long remaining = 0;
+    if (FastWake::workDue(state, remaining)) {
+        return;
+    }
+
+    TraceRecorder::begin();
+    TraceRecorder::recordWake(wakeCause());
+    TraceRecorder::recordSleep(true, remaining);
+
+    // Nothing to do: sleep out the rest of the period with the same wake sources
+    FastWake::save(remaining, state.wakePin, state.wakeLevel, state.slackMs);
+    #if defined(ESP32)
+    esp_sleep_enable_timer_wakeup(remaining * 1000ULL);
+    FastWake::armWakePin(state.wakePin, state.wakeLevel);
+    esp_deep_sleep_start();
+    #elif defined(ESP8266)
+    ESP.deepSleep(remaining * 1000ULL);
+    #endif
+}
+
+bool ESPLowPowerSensor::setWakePin(uint8_t pin, bool level) {
+    #if ESP_LOW_POWER_SENSOR_HAS_EXT0_WAKE
+    if (!rtc_gpio_is_valid_gpio(static_cast<gpio_num_t>(pin))) {
+        Serial.println("Wake pin must be an RTC GPIO");
+        return false;
+    }
+    _wakePin = pin;
+    _wakeLevel = level;
     return true;
+    #else
+    (void)pin;
+    (void)level;
+    Serial.println("Deep-sleep wake on a pin is not supported on this chip");
+    return false;
+    #endif
+}
+
+void ESPLowPowerSensor::setNodeId(uint32_t id) {
+    _uplink.setNodeId(id);
+    _reports.setNodeId(id);
+    _nodeIdSet = true;
+}
+
+void ESPLowPowerSensor::setTransport(Transport* transport) {
+    _transport = transport;
+    _reports.setTransport(transport);
+}
+
+bool ESPLowPowerSensor::report(const uint8_t* data, size_t length) {
+    if (_transport == nullptr || !_wifiRequired) {
+        Serial.println("Reports need a transport and WiFi required in initialize()");
+        return false;
+    }
+    if (!startTransport()) {
+        return false;
+    }
+    return _reports.queue(data, length);
+}
+
+bool ESPLowPowerSensor::flushReports() {
+    if (_reports.pending() == 0) {
+        return true;
+    }
+    return startTransport() && _reports.flush();
+}
+
+bool ESPLowPowerSensor::ensureWifi() {
+    if (!_wifiRequired) {
+        return true;
+    }
+    if (_transport != nullptr) {
+        return startTransport();
+    }
+    if (WiFi.status() == WL_CONNECTED) {
+        return true;
+    }
+    _wifiInitialized = initializeWifi();
+    return _wifiInitialized;
+}
+
+void ESPLowPowerSensor::prepareForWork() {
+    // A pipelined cycle is already connecting; its uplink function waits for it
+    if (wifiOnDemand() && !_pipelineActive && isUplinkDue()) {
+        ensureWifi();
+    }
+}
+
+unsigned long ESPLowPowerSensor::resumeLastExecution(unsigned long currentTime, unsigned long interval) {
+    if (_resumePending) {
+        // millis() restarted at the wake; place the last execution so the
+        // period ends when it would have without the reset. The sleep ran
+        // _cycleJitter past the end of the period.
+        _resumePending = false;
+        unsigned long period = interval + _cycleJitter;
+        unsigned long remaining = std::min(_resumeRemaining, period);
+        _lastExecutionTime = currentTime - (period - remaining);
+    }
+    return _lastExecutionTime;
 }
 
 void ESPLowPowerSensor::run() {
+    restorePersistedConfig();
+
+    if (_batteryPolicyEnabled) {
+        updateBatteryPolicy();
+        if (_batteryPolicy.tier() == BatteryPolicy::Tier::HIBERNATE) {
+            runHibernate();
+            return;
+        }
+    }
+
     if (_mode == Mode::PER_SENSOR) {
         runPerSensorMode();
     } else {
@@ -116,61 +557,226 @@ void ESPLowPowerSensor::run() {
 }
 
 void ESPLowPowerSensor::runPerSensorMode() {
+    // Sensors the timer interrupt found due are queued and run first
+    if (_interruptOccurred) {
+        handleInterrupt();
+        processInterruptQueue();
+    }
+
     unsigned long currentTime = millis();
-    for (size_t i = 0; i < _sensorCount; ++i) {
-        auto& sensor = _sensors[i];
+
+    // Timed sensors come off the due-time heap in order; executing a sensor
+    // moves its due time past currentTime, so each runs at most once here
+    SensorId id;
+    while ((id = _registry.peekDue(currentTime)) != INVALID_SENSOR) {
+        executeSensor(id);
+    }
+
+    // Pin-triggered sensors have no due time and are checked on every run
+    const auto& polled = _registry.polled();
+    for (size_t i = 0; i < polled.size(); ++i) {
+        id = polled[i];
+        const auto& sensor = _sensors[id];
         bool shouldExecute = false;
 
         switch (sensor.triggerMode) {
-            case TriggerMode::TIME_INTERVAL:
-                shouldExecute = (currentTime - sensor.lastExecutionTime >= sensor.triggerValue.interval);
-                break;
             case TriggerMode::DIGITAL:
                 shouldExecute = checkDigitalTrigger(sensor);
                 break;
             case TriggerMode::ANALOG_TRIGGER:
                 shouldExecute = checkAnalogTrigger(sensor);
                 break;
+            default:
+                break;
         }
 
         if (shouldExecute) {
-            executeSensor(i);
+            executeSensor(id);
         }
     }
 }
 
 void ESPLowPowerSensor::runSingleIntervalMode() {
     unsigned long currentTime = millis();
-    if (currentTime - _lastExecutionTime >= _singleInterval || currentTime < _lastExecutionTime) {
-        for (size_t i = 0; i < _sensorCount; ++i) {
-            executeSensor(i);
+    unsigned long interval = effectiveInterval(_singleInterval);
+    resumeLastExecution(currentTime, interval);
+    if (_slotPending) {
+        _slotPending = false;
+        if (_uplinkStaggered) {
+            _lastExecutionTime = currentTime - (interval - _uplink.slotOffset(interval));
         }
+    }
+
+    if (currentTime - _lastExecutionTime >= interval) {
+        if (_batteryPolicyEnabled) {
+            _batteryPolicy.onWake();
+            saveBatteryPolicyState();
+        }
+
+        // Pipelined: associate while the sensors sample; the uplink sends
+        // the readings of the whole cycle once both are done
+        bool uplinkDue = isUplinkDue();
+        _pipelineActive = _pipelined && _wifiRequired && uplinkDue && beginWifiConnect();
+        for (size_t id = 0; id < _registry.slotCount(); ++id) {
+            if (_registry.isEnabled(id)) {
+                executeSensor(id);
+            }
+        }
+        _pipelineActive = false;
+        if (uplinkDue) {
+            deliverReadings();
+        }
+        // The next period starts at this cycle's slot, not at the jittered
+        // wake, so the jitter of successive cycles does not add up
+        unsigned long late = currentTime - _lastExecutionTime - interval;
+        _lastExecutionTime = currentTime - std::min(late, _cycleJitter);
+        if (_uplinkStaggered) {
+            // Nodes whose clocks drift into the same slot still connect at different times
+            _cycleJitter = _uplink.cycleJitter(interval);
+        }
+    }
+    goToSleep(interval - (currentTime - _lastExecutionTime) + _cycleJitter, _cycleJitter);
+}
+
+void ESPLowPowerSensor::runHibernate() {
+    unsigned long currentTime = millis();
+    unsigned long heartbeat = _batteryPolicy.config().heartbeatInterval;
+    resumeLastExecution(currentTime, heartbeat);
+
+    // Only the heartbeat runs; every other sensor waits for the battery to recover
+    if (_heartbeatPending || currentTime - _lastExecutionTime >= heartbeat) {
+        _batteryPolicy.onWake();
+        saveBatteryPolicyState();
+        prepareForWork();
+        if (_heartbeatFunction) {
+            _heartbeatFunction();
+        }
+        _heartbeatPending = false;
         _lastExecutionTime = currentTime;
     }
-    goToSleep(_singleInterval - (currentTime - _lastExecutionTime));
+    goToSleep(heartbeat - (currentTime - _lastExecutionTime));
 }
 
-void ESPLowPowerSensor::executeSensor(size_t index) {
-    if (index >= _sensorCount) {
+void ESPLowPowerSensor::enableBatteryPolicy(uint8_t adcPin, float dividerRatio, const BatteryPolicy::Config& config) {
+    _batteryPolicy = BatteryPolicy(config);
+    _batteryPin = adcPin;
+    _batteryDividerRatio = dividerRatio;
+    _batterySampled = false;
+    _batteryPolicyEnabled = true;
+
+    #if defined(ESP32)
+    pinMode(adcPin, INPUT);
+    #endif
+
+    // Pick up the tier and wake count from before the last deep sleep
+    if (RtcMemory::wokeFromDeepSleep()) {
+        PersistedPolicyState saved;
+        if (RtcMemory::read(RtcMemory::POLICY_OFFSET, &saved, sizeof(saved)) && saved.magic == POLICY_MAGIC) {
+            _batteryPolicy.restore(saved.state);
+        }
+    }
+}
+
+void ESPLowPowerSensor::updateBatteryPolicy() {
+    unsigned long currentTime = millis();
+    if (_batterySampled && currentTime - _lastBatterySample < _batteryPolicy.config().sampleInterval) {
         return;
     }
+    _batterySampled = true;
+    _lastBatterySample = currentTime;
+
+    uint16_t millivolts = readSupplyMillivolts();
+    if (millivolts == 0) {
+        return;  // No reading; keep the current tier
+    }
+
+    BatteryPolicy::Tier previous = _batteryPolicy.tier();
+    _batteryPolicy.update(millivolts);
+    if (_mode == Mode::PER_SENSOR) {
+        _batteryPolicy.onWake();
+    }
+    if (_batteryPolicy.tier() == BatteryPolicy::Tier::HIBERNATE && previous != BatteryPolicy::Tier::HIBERNATE) {
+        _heartbeatPending = true;
+    }
+    saveBatteryPolicyState();
+}
+
+uint16_t ESPLowPowerSensor::readSupplyMillivolts() const {
+    #if defined(ESP32)
+    return static_cast<uint16_t>(analogReadMilliVolts(_batteryPin) * _batteryDividerRatio);
+    #elif defined(ESP8266)
+    return ESP.getVcc();
+    #endif
+}
+
+void ESPLowPowerSensor::saveBatteryPolicyState() const {
+    PersistedPolicyState saved = {POLICY_MAGIC, _batteryPolicy.state(), 0};
+    RtcMemory::write(RtcMemory::POLICY_OFFSET, &saved, sizeof(saved));
+}
+
+unsigned long ESPLowPowerSensor::effectiveInterval(unsigned long interval) const {
+    return _batteryPolicyEnabled ? _batteryPolicy.scaleInterval(interval) : interval;
+}
+
+void ESPLowPowerSensor::changeInterval(SensorId id, unsigned long interval) {
+    // Sensors are rescheduled with the battery-scaled interval, so the last
+    // execution time is only recovered by taking that scaled interval off
+    unsigned long lastExecution = _registry.nextDue(id) - effectiveInterval(_registry.interval(id));
+    _registry.updateInterval(id, interval);
+    _registry.reschedule(id, lastExecution + effectiveInterval(interval));
+}
+
+void ESPLowPowerSensor::executeSensor(SensorId id) {
+    if (!_registry.isEnabled(id)) {
+        return;
+    }
+
+    if (_batteryPolicyEnabled && _batteryPolicy.settings().suppressOptional &&
+        (_registry.flags(id) & SensorRegistry::FLAG_OPTIONAL)) {
+        // Skipped to save power; check again after another interval
+        _registry.reschedule(id, millis() + effectiveInterval(_registry.interval(id)));
+        return;
+    }
+
+    prepareForWork();
 
-    auto& sensor = _sensors[index];
+    // Move the callbacks out while they run, so a callback may remove its
+    // sensor or add sensors (which may grow _sensors); moving, unlike
+    // copying, never allocates
+    std::function<void()> wakeFunction = std::move(_sensors[id].wakeFunction);
+    std::function<void()> sleepFunction = std::move(_sensors[id].sleepFunction);
+    SensorId outerDispatch = _dispatching;
+    bool outerRemoved = _dispatchRemoved;
+    _dispatching = id;
+    _dispatchRemoved = false;
+    TraceRecorder::record(TraceRecorder::EventType::DISPATCH_BEGIN, 0, id);
     
-    if (sensor.wakeFunction) {
-        sensor.wakeFunction();
+    if (wakeFunction) {
+        wakeFunction();
     }
     
     // Perform any necessary operations here
     
-    if (sensor.sleepFunction) {
-        sensor.sleepFunction();
+    if (sleepFunction) {
+        sleepFunction();
     }
+
+    TraceRecorder::record(TraceRecorder::EventType::DISPATCH_END, 0, id);
+
+    // A removed sensor's slot may already hold a new sensor
+    if (!_dispatchRemoved) {
+        _sensors[id].wakeFunction = std::move(wakeFunction);
+        _sensors[id].sleepFunction = std::move(sleepFunction);
+    }
+    _dispatching = outerDispatch;
+    _dispatchRemoved = outerRemoved;
     
-    sensor.lastExecutionTime = millis();
+    if (_registry.contains(id)) {
+        _registry.reschedule(id, millis() + effectiveInterval(_registry.interval(id)));
+    }
 }
 
-void ESPLowPowerSensor::goToSleep(unsigned long sleepTime) const {
+void ESPLowPowerSensor::goToSleep(unsigned long sleepTime, unsigned long slackTime) const {
     // Check if sleepTime is zero or negative
     if (sleepTime == 0) {
         return;
@@ -188,9 +794,14 @@ void ESPLowPowerSensor::goToSleep(unsigned long sleepTime) const {
         }
     }
 
+    TraceRecorder::recordSleep(_lowPowerMode == LowPowerMode::DEEP_SLEEP, sleepTime);
+
     if (_lowPowerMode == LowPowerMode::DEEP_SLEEP) {
+        // Record the sleep so sleepIfIdle() can judge the next wake before setup runs
+        FastWake::save(sleepTime, _wakePin, _wakeLevel, slackTime);
         #if defined(ESP32)
         esp_sleep_enable_timer_wakeup(sleepTime * 1000ULL); // Convert to microseconds
+        FastWake::armWakePin(_wakePin, _wakeLevel);
         esp_deep_sleep_start();
         #elif defined(ESP8266)
         ESP.deepSleep(sleepTime * 1000ULL); // Convert to microseconds
@@ -207,9 +818,12 @@ void ESPLowPowerSensor::goToSleep(unsigned long sleepTime) const {
             yield(); // Allow background tasks to run
         }
         #endif
+        TraceRecorder::recordWake(wakeCause());
     }
 
-    if (_wifiRequired) {
+    // With the battery policy batching uplinks, only bring WiFi back for wakes
+    // that use it; deferred WiFi connects when the work is due instead
+    if (_wifiRequired && !wifiOnDemand() && (!_batteryPolicyEnabled || _batteryPolicy.uplinkDue(1))) {
         if (!wifiOn()) {
             // Handle WiFi turn on error (e.g., log it or set an error flag)
             // For now, we'll continue even if WiFi couldn't be turned on
@@ -222,6 +836,14 @@ bool ESPLowPowerSensor::wifiOff() const {
         return true;
     }
 
+    if (_transport != nullptr) {
+        stopTransport();
+        return true;
+    }
+
+    _wifiConnecting = false;
+    TraceRecorder::record(TraceRecorder::EventType::WIFI, static_cast<uint8_t>(TraceRecorder::WifiState::OFF));
+
     #if defined(ESP32)
     return WiFi.disconnect(true);
     #elif defined(ESP8266)
@@ -234,10 +856,16 @@ bool ESPLowPowerSensor::wifiOn() const {
         return true;
     }
 
+    if (_transport != nullptr) {
+        return startTransport();
+    }
+
     if (!_wifiInitialized) {
         return initializeWifi();
     }
 
+    TraceRecorder::record(TraceRecorder::EventType::WIFI, static_cast<uint8_t>(TraceRecorder::WifiState::CONNECTING));
+
     #if defined(ESP32)
     return WiFi.begin();
     #elif defined(ESP8266)
@@ -251,25 +879,33 @@ bool ESPLowPowerSensor::setMode(Mode newMode) {
     }
 
     // Check if there are any sensors added
-    if (_sensorCount > 0) {
+    // Only TIME_INTERVAL sensors have an interval; for DIGITAL and
+    // ANALOG_TRIGGER sensors the trigger value holds a level or threshold
+    bool foundTimed = false;
+    unsigned long firstInterval = 0;
+    for (size_t id = 0; id < _registry.slotCount(); ++id) {
+        if (!_registry.contains(id) || _sensors[id].triggerMode != TriggerMode::TIME_INTERVAL) {
+            continue;
+        }
+        unsigned long interval = _registry.interval(id);
+
         // If changing to SINGLE_INTERVAL mode, ensure all sensors have the same interval
         if (newMode == Mode::SINGLE_INTERVAL) {
-            unsigned long firstInterval = _sensors[0].triggerValue.interval;
-            for (size_t i = 0; i < _sensorCount; ++i) {
-                if (_sensors[i].triggerValue.interval != firstInterval) {
-                    return false; // Cannot change to SINGLE_INTERVAL mode with different intervals
-                }
+            if (!foundTimed) {
+                firstInterval = interval;
+            } else if (interval != firstInterval) {
+                return false; // Cannot change to SINGLE_INTERVAL mode with different intervals
             }
-            _singleInterval = firstInterval;
         }
         // If changing to PER_SENSOR mode, ensure all sensors have non-zero intervals
-        else if (newMode == Mode::PER_SENSOR) {
-            for (size_t i = 0; i < _sensorCount; ++i) {
-                if (_sensors[i].triggerValue.interval == 0) {
-                    return false; // Cannot change to PER_SENSOR mode with zero intervals
-                }
-            }
+        else if (newMode == Mode::PER_SENSOR && interval == 0) {
+            return false; // Cannot change to PER_SENSOR mode with zero intervals
         }
+        foundTimed = true;
+    }
+
+    if (newMode == Mode::SINGLE_INTERVAL && foundTimed) {
+        _singleInterval = firstInterval;
     }
 
     _mode = newMode;
@@ -311,15 +947,18 @@ void ESPLowPowerSensor::handleInterrupt() {
     _interruptOccurred = true;
 
     unsigned long currentTime = millis();
-    for (size_t i = 0; i < _sensorCount; ++i) {
-        if (currentTime - _sensors[i].lastExecutionTime >= _sensors[i].triggerValue.interval) {
-            if (!_interruptQueue.full()) {
-                _interruptQueue.push(i);
-            } else {
-                // Handle queue overflow (e.g., log an error)
-                Serial.println("Interrupt queue overflow");
-            }
+    SensorId id;
+    while ((id = _registry.peekDue(currentTime)) != INVALID_SENSOR) {
+        if (_interruptQueue.full()) {
+            // Sensors left on the heap stay due and are queued on the next interrupt
+            Serial.println("Interrupt queue overflow");
+            TraceRecorder::record(TraceRecorder::EventType::QUEUE_OVERFLOW, 0, id);
+            break;
         }
+        _interruptQueue.push(id);
+        // Provisionally reschedule so the sensor is not queued twice;
+        // executeSensor() sets the real due time once it has run
+        _registry.reschedule(id, currentTime + _registry.interval(id));
     }
 
     _interruptOccurred = false;
@@ -329,19 +968,8 @@ void ESPLowPowerSensor::handleInterrupt() {
 void ESPLowPowerSensor::processInterruptQueue() {
     size_t sensorIndex;
     while (_interruptQueue.pop(sensorIndex)) {
-        if (sensorIndex < _sensorCount) {
-            auto& sensor = _sensors[sensorIndex];
-            
-            // Execute wake and sleep functions for the sensor
-            if (sensor.wakeFunction) {
-                sensor.wakeFunction();
-            }
-            if (sensor.sleepFunction) {
-                sensor.sleepFunction();
-            }
-
-            sensor.lastExecutionTime = millis();
-        }
+        // Sensors removed since they were queued are skipped by executeSensor()
+        executeSensor(static_cast<SensorId>(sensorIndex));
     }
 }
 
@@ -375,30 +1003,132 @@ bool ESPLowPowerSensor::initializeWifi() const {
         return true;
     }
 
+    if (_transport != nullptr) {
+        return startTransport();
+    }
+
+    return beginWifiConnect() && finishWifiConnect();
+}
+
+bool ESPLowPowerSensor::beginWifiConnect() const {
+    if (!_wifiRequired) {
+        return true;
+    }
+
+    if (_transport != nullptr) {
+        return startTransport();
+    }
+
     if (_wifiSSID == nullptr || _wifiPassword == nullptr) {
         Serial.println("WiFi credentials not set. Call setWiFiCredentials before init.");
         return false;
     }
 
-    #if defined(ESP32) || defined(ESP8266)
+    if (_wifiConnecting || WiFi.status() == WL_CONNECTED) {
+        return true;
+    }
+
+    #if defined(ESP8266)
+    WiFi.forceSleepWake();  // The modem may still be asleep from wifiOff()
+    #endif
     WiFi.mode(WIFI_STA);
+    _wifiConnecting = true;
+    _wifiAttempt = 0;
+    startWifiAttempt();
+    return true;
+}
+
+void ESPLowPowerSensor::startWifiAttempt() const {
+    TraceRecorder::record(TraceRecorder::EventType::WIFI, static_cast<uint8_t>(TraceRecorder::WifiState::CONNECTING));
     WiFi.begin(_wifiSSID, _wifiPassword);
+    _wifiAttemptStart = millis();
+}
+
+bool ESPLowPowerSensor::pollWifi() const {
+    if (_transport != nullptr) {
+        return _transportActive;
+    }
+
+    if (WiFi.status() != WL_CONNECTED) {
+        return false;
+    }
+    if (_wifiConnecting) {
+        _wifiConnecting = false;
+        Serial.println("\nWiFi connected");
+        TraceRecorder::record(TraceRecorder::EventType::WIFI, static_cast<uint8_t>(TraceRecorder::WifiState::CONNECTED));
+    }
+    return true;
+}
+
+bool ESPLowPowerSensor::finishWifiConnect() const {
+    if (_transport != nullptr || !_wifiConnecting) {
+        return pollWifi();
+    }
+
     // Wait for connection
-    unsigned long startTime = millis();
-    while (WiFi.status() != WL_CONNECTED) {
-        if (millis() - startTime > 10000) { // 10 second timeout
+    const UplinkSchedule::Config& config = _uplink.config();
+    while (!pollWifi()) {
+        unsigned long waited = millis() - _wifiAttemptStart;
+        if (waited < config.attemptTimeoutMs) {
+            // Poll often, but print progress only every 500 ms as before
+            delay(100);
+            if ((millis() - _wifiAttemptStart) / 500 != waited / 500) {
+                Serial.print(".");
+            }
+            continue;
+        }
+
+        // Back off with the radio off, so nodes contending for the access
+        // point retry at different times
+        WiFi.disconnect(true);
+        if (++_wifiAttempt >= config.maxAttempts) {
+            _wifiConnecting = false;
             Serial.println("Failed to connect to WiFi");
+            TraceRecorder::record(TraceRecorder::EventType::WIFI, static_cast<uint8_t>(TraceRecorder::WifiState::FAILED));
             return false;
         }
-        delay(500);
-        Serial.print(".");
+        TraceRecorder::record(TraceRecorder::EventType::WIFI, static_cast<uint8_t>(TraceRecorder::WifiState::OFF));
+        delay(_uplink.backoffDelay(_wifiAttempt - 1));
+        startWifiAttempt();
     }
-    Serial.println("\nWiFi connected");
-    #endif
-
     return true;
 }
 
+void ESPLowPowerSensor::deliverReadings() {
+    if (!_uplinkFunction) {
+        return;
+    }
+    // Without WiFi required the uplink function brings up its own radio
+    if (!_wifiRequired || finishWifiConnect()) {
+        _uplinkFunction();
+    }
+}
+
+bool ESPLowPowerSensor::startTransport() const {
+    if (_transportActive) {
+        return true;
+    }
+
+    TraceRecorder::record(TraceRecorder::EventType::WIFI, static_cast<uint8_t>(TraceRecorder::WifiState::CONNECTING));
+    _transportActive = _transport->begin();
+    TraceRecorder::record(TraceRecorder::EventType::WIFI, static_cast<uint8_t>(
+        _transportActive ? TraceRecorder::WifiState::CONNECTED : TraceRecorder::WifiState::FAILED));
+    return _transportActive;
+}
+
+void ESPLowPowerSensor::stopTransport() const {
+    if (_transportActive) {
+        if (!_reports.flush()) {
+            // Sleep ends the wake; the reports are not carried over
+            Serial.println("Reports not acknowledged by the gateway");
+            _reports.discard();
+        }
+        _transport->end();
+        _transportActive = false;
+    }
+    TraceRecorder::record(TraceRecorder::EventType::WIFI, static_cast<uint8_t>(TraceRecorder::WifiState::OFF));
+}
+
 bool ESPLowPowerSensor::checkDigitalTrigger(const Sensor& sensor) {
     return digitalRead(sensor.pin) == sensor.triggerValue.digitalValue;
 }
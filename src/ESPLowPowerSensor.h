@@ -7,6 +7,13 @@
 #include <queue>
 #include <atomic>
 #include <array>
+#include "SensorRegistry.h"
+#include "RtcConfigStore.h"
+#include "BatteryPolicy.h"
+#include "FastWake.h"
+#include "TraceRecorder.h"
+#include "UplinkSchedule.h"
+#include "ReportLink.h"
 
 #if defined(ESP32)
 #include <WiFi.h>
@@ -17,7 +24,11 @@
 #endif
 
 constexpr size_t CIRCULAR_BUFFER_SIZE = 32;
-constexpr size_t MAX_SENSORS = 10;
+#ifndef ESP_LOW_POWER_SENSOR_MAX_SENSORS
+#define ESP_LOW_POWER_SENSOR_MAX_SENSORS 256
+#endif
+
+constexpr size_t MAX_SENSORS = ESP_LOW_POWER_SENSOR_MAX_SENSORS;
 
 class CircularBuffer {
 private:
@@ -99,9 +110,16 @@ public:
         ANALOG_TRIGGER
     };
 
+    using SensorId = SensorRegistry::SensorId;
+
+    static constexpr SensorId INVALID_SENSOR = SensorRegistry::INVALID_ID;  ///< Id returned when a sensor could not be added
+
     /**
      * @struct Sensor
-     * @brief Represents a sensor with its associated functions and timing information.
+     * @brief Represents a sensor with its associated functions and trigger configuration.
+     *
+     * Scheduling state (next due time, interval, flags) is kept separately in the
+     * SensorRegistry so the scheduler does not have to touch callback data.
      */
     struct Sensor {
         std::function<void()> wakeFunction;    ///< Function to be called when the sensor wakes up
@@ -112,10 +130,31 @@ public:
             bool digitalValue;                 ///< HIGH or LOW for DIGITAL mode
             int analogValue;                   ///< ANALOG_TRIGGER threshold value for ANALOG_TRIGGER mode
         } triggerValue;
-        unsigned long lastExecutionTime;       ///< Last time the sensor functions were executed
         uint8_t pin;                           ///< Pin number for DIGITAL or ANALOG_TRIGGER modes
     };
 
+    /**
+     * @enum ConfigAction
+     * @brief Defines what a SensorConfig entry changes.
+     */
+    enum class ConfigAction : uint8_t {
+        ENABLE,              ///< Resume executing the sensor
+        DISABLE,             ///< Stop executing the sensor without removing it
+        SET_VALUE,           ///< Set the interval (TIME_INTERVAL) or threshold (DIGITAL/ANALOG_TRIGGER)
+        REMOVE,              ///< Remove the sensor
+        SET_SINGLE_INTERVAL  ///< Set the interval used in SINGLE_INTERVAL mode (id is ignored)
+    };
+
+    /**
+     * @struct SensorConfig
+     * @brief One entry of a runtime configuration blob passed to applyConfig().
+     */
+    struct SensorConfig {
+        SensorId id;          ///< Sensor to change
+        ConfigAction action;  ///< What to change
+        unsigned long value;  ///< New interval or threshold for SET_VALUE and SET_SINGLE_INTERVAL
+    };
+
     /**
      * @brief Default constructor.
      */
@@ -130,6 +169,172 @@ public:
      */
     bool initialize(Mode mode, bool wifiRequired, LowPowerMode lowPowerMode);
 
+    /**
+     * @brief Returns to deep sleep at once if this wake has nothing to do.
+     *
+     * Call this first in setup(), before Serial, WiFi or sensor setup. After a
+     * deep-sleep wake that came early, or from a wake pin that has already gone
+     * back to its idle level (a bounce), the chip goes straight back to sleep
+     * for the rest of the original period and this function does not return.
+     * Otherwise, including after power-on, it returns immediately.
+     */
+    static void sleepIfIdle();
+
+    /**
+     * @brief Sets a pin that wakes the chip from deep sleep (ESP32 with EXT0 wake-up only).
+     * @param pin An RTC-capable GPIO.
+     * @param level The level that wakes the chip (HIGH or LOW).
+     * @return True if the pin can wake the chip, false otherwise.
+     */
+    bool setWakePin(uint8_t pin, bool level);
+
+    /**
+     * @brief Defers connecting to WiFi until work that needs it is due.
+     *
+     * Must be called before initialize(). initialize() then returns without
+     * connecting, and the connection is made just before the first sensor or
+     * heartbeat function runs on a wake where the uplink is due. Callbacks can
+     * also call ensureWifi() themselves.
+     *
+     * @param defer Whether to defer the connection.
+     */
+    void deferWifiUntilNeeded(bool defer = true) { _wifiDeferred = defer; }
+
+    /**
+     * @brief Overlaps WiFi association with the sensors in SINGLE_INTERVAL mode.
+     *
+     * Each cycle where the uplink is due starts connecting before the first
+     * sensor runs instead of waiting for the connection first, so the cycle
+     * is awake for the longer of association and sampling rather than their
+     * sum. Sensor callbacks should only sample; the uplink function set with
+     * setUplinkFunction() sends. initialize() returns without connecting.
+     * Outside SINGLE_INTERVAL mode this behaves like deferWifiUntilNeeded().
+     * Must be called before initialize().
+     *
+     * @param enabled Whether to pipeline cycles.
+     */
+    void enablePipelining(bool enabled = true) { _pipelined = enabled; }
+
+    /**
+     * @brief Sets the function that sends readings in SINGLE_INTERVAL mode.
+     *
+     * It is called once per cycle where the uplink is due, after the last
+     * enabled sensor has run and WiFi (or the transport) is up, and should
+     * send the readings of the whole cycle.
+     *
+     * @param uplinkFunction Function to call.
+     */
+    void setUplinkFunction(std::function<void()> uplinkFunction) { _uplinkFunction = uplinkFunction; }
+
+    /**
+     * @brief Connects to WiFi if required and not already connected.
+     * @return True if WiFi is connected or not required, false if connecting failed.
+     */
+    bool ensureWifi();
+
+    /**
+     * @brief Staggers single-interval cycles so nodes sharing an access point do not all connect at once.
+     *
+     * After power-on the first cycle starts at this node's transmit slot
+     * within the interval instead of immediately, and every cycle starts a
+     * small random jitter after the slot; see UplinkSchedule. The jitter does
+     * not accumulate, and deep-sleep wakes keep the slot. Must be called
+     * before initialize().
+     *
+     * @param enabled Whether to stagger cycles.
+     */
+    void enableUplinkStagger(bool enabled = true) { _uplinkStaggered = enabled; }
+
+    /**
+     * @brief Sets the slot, jitter and WiFi connection backoff settings.
+     * @param config The settings; see UplinkSchedule::defaults().
+     */
+    void setUplinkSchedule(const UplinkSchedule::Config& config) { _uplink.setConfig(config); }
+
+    /**
+     * @brief Sets the id that picks this node's transmit slot, instead of one derived from the MAC address.
+     *
+     * Nodes numbered 0 to slotCount - 1 get distinct slots. Must be called before initialize().
+     *
+     * @param id The node id.
+     */
+    void setNodeId(uint32_t id);
+
+    /**
+     * @brief Gets the id that picks this node's transmit slot.
+     * @return The configured id, or one derived from the MAC address once initialize() has run.
+     */
+    uint32_t getNodeId() const { return _uplink.nodeId(); }
+
+    /**
+     * @brief Gets the offset of this node's transmit slot within the single interval.
+     * @return The offset in milliseconds.
+     */
+    unsigned long getUplinkSlotOffset() const { return _uplink.slotOffset(_singleInterval); }
+
+    /**
+     * @brief Sends reports over a connectionless transport, e.g. EspNowTransport, instead of connecting to WiFi.
+     *
+     * With a transport set, initialize(..., true, ...) and the sleep cycle
+     * start and stop the transport where they would connect and disconnect
+     * WiFi, and no WiFi credentials are needed. Must be called before initialize().
+     *
+     * @param transport The transport, or nullptr to use WiFi.
+     */
+    void setTransport(Transport* transport);
+
+    /**
+     * @brief Sets how long to wait for the gateway's ack and how often to resend.
+     * @param config The settings; see ReportLink::defaults().
+     */
+    void setReportConfig(const ReportLink::Config& config) { _reports.setConfig(config); }
+
+    /**
+     * @brief Queues a short report for the gateway.
+     *
+     * Reports queued during a wake are batched into as few frames as fit and
+     * sent, with acks and retries, before the node sleeps or when
+     * flushReports() is called. Starts the transport if it is not running.
+     * If the report does not fit in the current frame, that frame is sent
+     * first; if it is not acknowledged it is dropped and counted as lost,
+     * and the report is still queued in a new frame.
+     *
+     * @param data The report.
+     * @param length The report length in bytes, at most 242 with ESP-NOW.
+     * @return True if the report was queued and any frame sent to make room was
+     * acknowledged. False if there is no transport, it could not start, the
+     * report is too long, or a frame sent to make room was lost; in the last
+     * case the report itself is still queued.
+     */
+    bool report(const uint8_t* data, size_t length);
+
+    /**
+     * @brief Sends the queued reports now and waits for the gateway's ack.
+     * @return True if the reports were acknowledged or none were queued, false otherwise.
+     */
+    bool flushReports();
+
+    /**
+     * @brief Gets the delivery counters of the report link.
+     * @return Frames delivered, resends and frames given up.
+     */
+    const ReportLink::Stats& getReportStats() const { return _reports.stats(); }
+
+    /**
+     * @brief Enables or disables the trace of wakes, sensor dispatches, WiFi changes and sleeps.
+     *
+     * The trace is kept in RTC memory across deep sleep; see TraceRecorder.
+     *
+     * @param enabled Whether to record events.
+     */
+    void enableTrace(bool enabled = true) { TraceRecorder::setEnabled(enabled); }
+
+    /**
+     * @brief Prints the trace for extras/trace/trace_to_chrome.py.
+     * @param out Where to print, e.g. Serial.
+     */
+    void dumpTrace(Print& out) const { TraceRecorder::dump(out); }
+
     /**
      * @brief Adds a sensor to be managed by the ESPLowPowerSensor.
      * @param wakeFunction Function to be called when the sensor wakes up.
@@ -137,13 +342,160 @@ public:
      * @param triggerMode The trigger mode for this sensor (optional).
      * @param intervalOrThreshold Sampling interval or threshold value for TIME_INTERVAL or ANALOG_TRIGGER mode (optional).
      * @param pin Pin number for DIGITAL or ANALOG_TRIGGER modes (optional).
+     * @param id Receives the id of the new sensor, for use with removeSensor() and updateInterval() (optional).
      * @return True if the sensor was successfully added, false otherwise.
      */
     bool addSensor(std::function<void()> wakeFunction, 
                    std::function<void()> sleepFunction = nullptr, 
                    TriggerMode triggerMode = TriggerMode::TIME_INTERVAL, 
                    unsigned long intervalOrThreshold = 0,
-                   uint8_t pin = 0);
+                   uint8_t pin = 0,
+                   SensorId* id = nullptr);
+
+    /**
+     * @brief Removes a sensor so it is no longer executed.
+     * @param id The id returned by addSensor().
+     * @return True if the sensor was removed, false if the id is unknown.
+     */
+    bool removeSensor(SensorId id);
+
+    /**
+     * @brief Changes the sampling interval of a TIME_INTERVAL sensor in PER_SENSOR mode.
+     *
+     * The sensor's last execution time is kept, so the new interval is measured
+     * from the previous run.
+     *
+     * @param id The id returned by addSensor().
+     * @param interval The new interval in milliseconds (must be non-zero).
+     * @return True if the interval was updated, false otherwise.
+     */
+    bool updateInterval(SensorId id, unsigned long interval);
+
+    /**
+     * @brief Changes the trigger level of a DIGITAL sensor or the threshold of an ANALOG_TRIGGER sensor.
+     * @param id The id returned by addSensor().
+     * @param threshold HIGH/LOW for DIGITAL sensors, the analog threshold for ANALOG_TRIGGER sensors.
+     * @return True if the threshold was updated, false otherwise.
+     */
+    bool updateThreshold(SensorId id, unsigned long threshold);
+
+    /**
+     * @brief Enables or disables a sensor without removing it.
+     * @param id The id returned by addSensor().
+     * @param enabled Whether the sensor should be executed.
+     * @return True if the sensor exists, false otherwise.
+     */
+    bool setSensorEnabled(SensorId id, bool enabled);
+
+    /**
+     * @brief Checks if a sensor exists and is enabled.
+     * @param id The id returned by addSensor().
+     * @return True if the sensor is enabled, false otherwise.
+     */
+    bool isSensorEnabled(SensorId id) const { return _registry.isEnabled(id); }
+
+    /**
+     * @brief Sets the interval used in SINGLE_INTERVAL mode.
+     * @param interval The interval in milliseconds (must be non-zero).
+     * @return True if the interval was set, false if not in SINGLE_INTERVAL mode or the interval is zero.
+     */
+    bool setSingleInterval(unsigned long interval);
+
+    /**
+     * @brief Applies a set of configuration changes atomically.
+     *
+     * Every entry is validated before any is applied, so either all changes
+     * take effect or none do. Applied changes are kept in RTC memory and
+     * replayed on the first run() after a deep-sleep wake, once the sketch has
+     * re-added its sensors in the same order.
+     *
+     * @param entries The configuration entries, applied in order.
+     * @param count The number of entries.
+     * @return True if all entries were applied, false if any entry was invalid.
+     */
+    bool applyConfig(const SensorConfig* entries, size_t count);
+
+    /**
+     * @brief Forgets configuration changes kept across deep sleep.
+     *
+     * Changes already applied stay in effect until the next reset.
+     */
+    void clearPersistedConfig();
+
+    /**
+     * @brief Enables the battery-aware degradation policy.
+     *
+     * The supply voltage is sampled on the first run() after each reset (so on
+     * every deep-sleep wake) and then at most every Config::sampleInterval.
+     * On ESP32 it is read from an ADC pin behind a voltage divider. On ESP8266
+     * ESP.getVcc() is used and the pin is ignored; the sketch must declare
+     * ADC_MODE(ADC_VCC).
+     *
+     * @param adcPin ADC pin connected to the divider (ESP32 only).
+     * @param dividerRatio Supply voltage divided by the voltage at the pin.
+     * @param config Tier thresholds and behaviour.
+     */
+    void enableBatteryPolicy(uint8_t adcPin, float dividerRatio = 2.0f,
+                             const BatteryPolicy::Config& config = BatteryPolicy::liIonDefaults());
+
+    /**
+     * @brief Disables the battery policy and returns to full service.
+     */
+    void disableBatteryPolicy() { _batteryPolicyEnabled = false; }
+
+    /**
+     * @brief Checks if the battery policy is enabled.
+     * @return True if the battery policy is enabled, false otherwise.
+     */
+    bool isBatteryPolicyEnabled() const { return _batteryPolicyEnabled; }
+
+    /**
+     * @brief Gets the current battery policy tier.
+     * @return The current tier; NORMAL when the policy is disabled.
+     */
+    BatteryPolicy::Tier getBatteryTier() const {
+        return _batteryPolicyEnabled ? _batteryPolicy.tier() : BatteryPolicy::Tier::NORMAL;
+    }
+
+    /**
+     * @brief Gets the last sampled supply voltage.
+     * @return The supply voltage in millivolts, or zero if not sampled yet.
+     */
+    uint16_t getSupplyMillivolts() const { return _batteryPolicy.millivolts(); }
+
+    /**
+     * @brief Checks if the uplink should be used on this wake.
+     *
+     * Sensor callbacks can use this to batch readings while the battery policy
+     * spreads uplinks over several wakes. Wakes are SINGLE_INTERVAL cycles,
+     * hibernation heartbeats, or voltage samples in PER_SENSOR mode.
+     *
+     * @return True if the uplink is due, always true when the policy is disabled.
+     */
+    bool isUplinkDue() const { return !_batteryPolicyEnabled || _batteryPolicy.uplinkDue(); }
+
+    /**
+     * @brief Marks a sensor as optional so the battery policy may skip it.
+     * @param id The id returned by addSensor().
+     * @param optional Whether the sensor is optional.
+     * @return True if the sensor exists, false otherwise.
+     */
+    bool setSensorOptional(SensorId id, bool optional) { return _registry.setOptional(id, optional); }
+
+    /**
+     * @brief Sets the function called on each wake while the battery policy hibernates.
+     * @param heartbeatFunction Function to call, e.g. to report the battery state.
+     */
+    void setHeartbeatFunction(std::function<void()> heartbeatFunction) { _heartbeatFunction = heartbeatFunction; }
+
+    /**
+     * @brief Gets the time until the next TIME_INTERVAL sensor is due.
+     * @param[out] remaining Milliseconds until the next sensor is due (zero if one is due now).
+     * @return True if any enabled TIME_INTERVAL sensor exists, false otherwise.
+     */
+    bool getTimeUntilNextSensor(unsigned long& remaining) const {
+        return _registry.timeUntilNextDue(millis(), remaining);
+    }
 
     /**
      * @brief Runs the main loop of the ESPLowPowerSensor.
@@ -176,7 +528,7 @@ public:
      * @brief Returns the number of sensors currently managed.
      * @return The number of sensors.
      */
-    size_t getSensorCount() const { return _sensorCount; }
+    size_t getSensorCount() const { return _registry.size(); }
 
     /**
      * @brief Gets the current operational mode.
@@ -219,8 +571,11 @@ private:
     Mode _mode;                      ///< Current operational mode
     bool _wifiRequired;              ///< Whether WiFi is required during sensor operations
     LowPowerMode _lowPowerMode;      ///< Current low-power mode
-    std::array<Sensor, MAX_SENSORS> _sensors;  ///< Collection of managed sensors
+    std::vector<Sensor> _sensors;    ///< Sensor callbacks and trigger configuration, indexed by SensorId
+    SensorRegistry _registry;        ///< Scheduling state of the managed sensors
     unsigned long _singleInterval;   ///< Interval used in SINGLE_INTERVAL mode
+    SensorId _dispatching;           ///< Sensor whose callbacks are running, or INVALID_SENSOR
+    bool _dispatchRemoved;           ///< Whether that sensor was removed by its own callbacks
 
     #if defined(ESP32)
     hw_timer_t* _timer = nullptr;
@@ -259,8 +614,9 @@ private:
     /**
      * @brief Puts the ESP into sleep mode for the specified duration.
      * @param sleepTime Duration to sleep in milliseconds.
+     * @param slackTime Part of sleepTime after the end of the scheduled period, kept across deep sleep.
      */
-    void goToSleep(unsigned long sleepTime) const;
+    void goToSleep(unsigned long sleepTime, unsigned long slackTime = 0) const;
 
     /**
      * @brief Turns off WiFi to conserve power.
@@ -275,13 +631,68 @@ private:
     bool wifiOn() const;
 
     bool initializeWifi() const;  ///< Initialize WiFi if not already done
-
-    size_t _sensorCount;
+    bool startTransport() const;  ///< Start the report transport if not already running
+    bool beginWifiConnect() const;   ///< Start connecting without waiting
+    void startWifiAttempt() const;
+    bool pollWifi() const;           ///< Check for the connection without waiting
+    bool finishWifiConnect() const;  ///< Wait for the connection started by beginWifiConnect(), retrying with backoff
+    void deliverReadings();          ///< Run the uplink function once connected
+    void stopTransport() const;   ///< Send queued reports and stop the report transport
+
+    RtcConfigStore _configStore;  ///< Runtime configuration changes kept across deep sleep
+    bool _configRestored;         ///< Whether persisted changes have been replayed since reset
+
+    BatteryPolicy _batteryPolicy;               ///< Tier state and thresholds
+    bool _batteryPolicyEnabled;                 ///< Whether the battery policy is applied
+    uint8_t _batteryPin;                        ///< ADC pin on the supply divider (ESP32)
+    float _batteryDividerRatio;                 ///< Supply voltage / pin voltage
+    bool _batterySampled;                       ///< Whether the voltage was sampled since reset
+    unsigned long _lastBatterySample;           ///< Time of the last voltage sample
+    bool _heartbeatPending;                     ///< Whether the heartbeat should run on the next hibernation run()
+    std::function<void()> _heartbeatFunction;   ///< Called on each hibernation wake
+
+    uint8_t _wakePin;                 ///< Deep-sleep wake pin, or FastWake::NO_WAKE_PIN
+    bool _wakeLevel;                  ///< Level on _wakePin that wakes the chip
+    bool _wifiDeferred;               ///< Whether WiFi connects only when work is due
+    bool _resumePending;              ///< Whether the next run() should resume the pre-sleep schedule
+    unsigned long _resumeRemaining;   ///< Time left of the pre-sleep period at wake
+
+    mutable UplinkSchedule _uplink;   ///< Transmit slot and connection backoff; drawing random delays is not an observable change
+    bool _uplinkStaggered;            ///< Whether single-interval cycles are staggered
+    unsigned long _cycleJitter;       ///< How long after its slot the next single-interval cycle starts
+    bool _nodeIdSet;                  ///< Whether the node id was configured rather than derived from the MAC address
+    bool _slotPending;                ///< Whether the next run() should move the first cycle to the transmit slot
+
+    bool _pipelined;                          ///< Whether single-interval cycles connect while the sensors run
+    bool _pipelineActive;                     ///< Whether a pipelined cycle is running its sensors
+    std::function<void()> _uplinkFunction;    ///< Sends readings in SINGLE_INTERVAL mode
+    mutable bool _wifiConnecting;             ///< Whether a connection was started and not yet finished
+    mutable uint8_t _wifiAttempt;             ///< Connection attempt in progress, from zero
+    mutable unsigned long _wifiAttemptStart;  ///< Start of the connection attempt in progress
+
+    Transport* _transport;            ///< Report transport used instead of WiFi, or nullptr
+    mutable ReportLink _reports;      ///< Batches reports and delivers them over _transport
+    mutable bool _transportActive;    ///< Whether _transport has been started
+
+    unsigned long resumeLastExecution(unsigned long currentTime, unsigned long interval);
+    void prepareForWork();
+    bool wifiOnDemand() const { return _wifiDeferred || _pipelined; }
+
+    void updateBatteryPolicy();
+    uint16_t readSupplyMillivolts() const;
+    void saveBatteryPolicyState() const;
+    void runHibernate();
+    unsigned long effectiveInterval(unsigned long interval) const;
+    void changeInterval(SensorId id, unsigned long interval);
+
+    bool validateConfig(const SensorConfig* entries, size_t count, RtcConfigStore& store) const;
+    void applyConfigEntry(const SensorConfig& entry);
+    void restorePersistedConfig();
 
     bool checkDigitalTrigger(const Sensor& sensor);
     bool checkAnalogTrigger(const Sensor& sensor);
 
-    void executeSensor(size_t index);
+    void executeSensor(SensorId id);
 
     unsigned long _lastExecutionTime;
 };
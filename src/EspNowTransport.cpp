@@ -0,0 +1,137 @@
+#include "EspNowTransport.h"
+#include <string.h>
+
+#if defined(ESP32)
+#include <WiFi.h>
+#include <esp_now.h>
+#include <esp_wifi.h>
+#if __has_include(<esp_idf_version.h>)
+#include <esp_idf_version.h>
+#endif
+#elif defined(ESP8266)
+#include <ESP8266WiFi.h>
+#include <espnow.h>
+#endif
+
+EspNowTransport* EspNowTransport::active = nullptr;
+
+struct EspNowCallbacks {
+    #if defined(ESP32) && ESP_IDF_VERSION_MAJOR >= 5
+    static void onReceive(const esp_now_recv_info_t* info, const uint8_t* data, int length) {
+        if (EspNowTransport::active != nullptr && length > 0) {
+            EspNowTransport::active->onReceive(info->src_addr, data, static_cast<size_t>(length));
+        }
+    }
+    #elif defined(ESP32)
+    static void onReceive(const uint8_t* mac, const uint8_t* data, int length) {
+        if (EspNowTransport::active != nullptr && length > 0) {
+            EspNowTransport::active->onReceive(mac, data, static_cast<size_t>(length));
+        }
+    }
+    #elif defined(ESP8266)
+    static void onReceive(uint8_t* mac, uint8_t* data, uint8_t length) {
+        if (EspNowTransport::active != nullptr) {
+            EspNowTransport::active->onReceive(mac, data, length);
+        }
+    }
+    #endif
+};
+
+EspNowTransport::EspNowTransport(const uint8_t gatewayMac[6], uint8_t channel)
+    : _channel(channel),
+      _active(false),
+      _received(),
+      _receivedLength(0) {
+    memcpy(_gatewayMac, gatewayMac, sizeof(_gatewayMac));
+}
+
+bool EspNowTransport::begin() {
+    if (_active) {
+        return true;
+    }
+
+    #if defined(ESP32)
+    WiFi.mode(WIFI_STA);
+    esp_wifi_set_channel(_channel, WIFI_SECOND_CHAN_NONE);
+    if (esp_now_init() != ESP_OK) {
+        Serial.println("ESP-NOW init failed");
+        return false;
+    }
+    esp_now_peer_info_t peer = {};
+    memcpy(peer.peer_addr, _gatewayMac, sizeof(_gatewayMac));
+    peer.channel = _channel;
+    peer.ifidx = WIFI_IF_STA;
+    peer.encrypt = false;
+    if (!esp_now_is_peer_exist(_gatewayMac) && esp_now_add_peer(&peer) != ESP_OK) {
+        Serial.println("ESP-NOW gateway peer could not be added");
+        esp_now_deinit();
+        return false;
+    }
+    #elif defined(ESP8266)
+    WiFi.forceSleepWake();
+    WiFi.mode(WIFI_STA);
+    wifi_set_channel(_channel);
+    if (esp_now_init() != 0) {
+        Serial.println("ESP-NOW init failed");
+        return false;
+    }
+    esp_now_set_self_role(ESP_NOW_ROLE_COMBO);
+    if (esp_now_add_peer(_gatewayMac, ESP_NOW_ROLE_COMBO, _channel, nullptr, 0) != 0) {
+        Serial.println("ESP-NOW gateway peer could not be added");
+        esp_now_deinit();
+        return false;
+    }
+    #endif
+
+    _receivedLength = 0;
+    active = this;
+    esp_now_register_recv_cb(EspNowCallbacks::onReceive);
+    _active = true;
+    return true;
+}
+
+void EspNowTransport::end() {
+    if (!_active) {
+        return;
+    }
+    _active = false;
+    active = nullptr;
+    esp_now_deinit();
+
+    #if defined(ESP32)
+    WiFi.mode(WIFI_OFF);
+    #elif defined(ESP8266)
+    WiFi.mode(WIFI_OFF);
+    WiFi.forceSleepBegin();
+    #endif
+}
+
+bool EspNowTransport::send(const uint8_t* frame, size_t length) {
+    if (!_active || length > MAX_FRAME) {
+        return false;
+    }
+
+    #if defined(ESP32)
+    return esp_now_send(_gatewayMac, frame, length) == ESP_OK;
+    #elif defined(ESP8266)
+    return esp_now_send(_gatewayMac, const_cast<uint8_t*>(frame), static_cast<int>(length)) == 0;
+    #endif
+}
+
+size_t EspNowTransport::receive(uint8_t* buffer, size_t size) {
+    size_t length = _receivedLength;
+    if (length == 0 || length > size) {
+        return 0;
+    }
+    memcpy(buffer, _received, length);
+    _receivedLength = 0;  // Frees the slot for the callback
+    return length;
+}
+
+void EspNowTransport::onReceive(const uint8_t* mac, const uint8_t* data, size_t length) {
+    if (_receivedLength != 0 || length > RECEIVE_SIZE || memcmp(mac, _gatewayMac, sizeof(_gatewayMac)) != 0) {
+        return;
+    }
+    memcpy(_received, data, length);
+    _receivedLength = length;
+}
@@ -0,0 +1,49 @@
+#ifndef ESP_NOW_TRANSPORT_H
+#define ESP_NOW_TRANSPORT_H
+
+#include <Arduino.h>
+#include "Transport.h"
+
+/**
+ * @class EspNowTransport
+ * @brief Sends ESP-NOW frames to one gateway, without associating with an access point.
+ *
+ * Bringing the radio up takes milliseconds instead of the seconds WiFi
+ * association and DHCP take. The gateway must listen on the same channel;
+ * when it is also connected to an access point, that is the access point's
+ * channel. Only frames from the gateway are received, one at a time; a frame
+ * that arrives before the last one was taken is dropped.
+ */
+class EspNowTransport : public Transport {
+public:
+    static constexpr size_t MAX_FRAME = 250;  ///< ESP-NOW payload limit
+    static constexpr size_t RECEIVE_SIZE = 32;
+
+    /**
+     * @brief Creates a transport to a gateway.
+     * @param gatewayMac MAC address of the gateway's station interface.
+     * @param channel WiFi channel shared with the gateway, 1 to 13.
+     */
+    EspNowTransport(const uint8_t gatewayMac[6], uint8_t channel);
+
+    bool begin() override;
+    void end() override;
+    size_t maxFrameSize() const override { return MAX_FRAME; }
+    bool send(const uint8_t* frame, size_t length) override;
+    size_t receive(uint8_t* buffer, size_t size) override;
+
+private:
+    uint8_t _gatewayMac[6];
+    uint8_t _channel;
+    bool _active;
+
+    // Filled by the ESP-NOW receive callback on the WiFi task
+    uint8_t _received[RECEIVE_SIZE];
+    volatile size_t _receivedLength;
+
+    static EspNowTransport* active;
+    void onReceive(const uint8_t* mac, const uint8_t* data, size_t length);
+    friend struct EspNowCallbacks;
+};
+
+#endif // ESP_NOW_TRANSPORT_H
@@ -0,0 +1,138 @@
+#include "FastWake.h"
+#include "RtcMemory.h"
+#include <stddef.h>
+
+#if ESP_LOW_POWER_SENSOR_HAS_EXT0_WAKE
+#include <driver/rtc_io.h>
+#endif
+
+#if defined(ESP32)
+#if __has_include(<esp_rtc_time.h>)
+#include <esp_rtc_time.h>
+#define FAST_WAKE_RTC_MICROS() esp_rtc_get_time_us()
+#else
+#include <esp_private/esp_clk.h>
+#define FAST_WAKE_RTC_MICROS() esp_clk_rtc_time()
+#endif
+#endif
+
+namespace {
+    constexpr uint32_t WAKE_MAGIC = 0x4C505357;  // "LPSW"
+
+    uint32_t checksumOf(const FastWake::State& state) {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&state);
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < offsetof(FastWake::State, checksum); ++i) {
+            hash = (hash ^ bytes[i]) * 16777619u;
+        }
+        return hash;
+    }
+}
+
+static_assert(sizeof(FastWake::State) <= 8 * RtcMemory::BLOCK_SIZE,
+              "FastWake state does not fit its RTC memory blocks");
+
+namespace FastWake {
+
+uint64_t rtcMicros() {
+    #if defined(ESP32)
+    return FAST_WAKE_RTC_MICROS();
+    #elif defined(ESP8266)
+    return 0;
+    #endif
+}
+
+void save(unsigned long sleepMs, uint8_t wakePin, bool wakeLevel, unsigned long slackMs) {
+    State state = {};
+    state.magic = WAKE_MAGIC;
+    state.sleepMs = sleepMs;
+    state.sleepStartUs = rtcMicros();
+    state.wakePin = wakePin;
+    state.wakeLevel = wakeLevel ? 1 : 0;
+    state.rtcIoNum = 0xFF;
+    state.slackMs = slackMs;
+    #if ESP_LOW_POWER_SENSOR_HAS_EXT0_WAKE
+    if (wakePin != NO_WAKE_PIN && rtc_gpio_is_valid_gpio(static_cast<gpio_num_t>(wakePin))) {
+        state.rtcIoNum = static_cast<uint8_t>(rtc_io_number_get(static_cast<gpio_num_t>(wakePin)));
+    }
+    #endif
+    state.checksum = checksumOf(state);
+    RtcMemory::write(RtcMemory::WAKE_OFFSET, &state, sizeof(state));
+}
+
+bool load(State& state, unsigned long& remaining) {
+    if (!RtcMemory::wokeFromDeepSleep() ||
+        !RtcMemory::read(RtcMemory::WAKE_OFFSET, &state, sizeof(state)) ||
+        state.magic != WAKE_MAGIC || state.checksum != checksumOf(state)) {
+        return false;
+    }
+
+    #if defined(ESP32)
+    uint64_t elapsedMs = (rtcMicros() - state.sleepStartUs) / 1000;
+    #elif defined(ESP8266)
+    uint64_t elapsedMs = state.sleepMs;  // Only the timer can wake an ESP8266 from deep sleep
+    #endif
+    remaining = elapsedMs < state.sleepMs ? static_cast<unsigned long>(state.sleepMs - elapsedMs) : 0;
+    return true;
+}
+
+bool workDue(State& state, unsigned long& remaining) {
+    if (!load(state, remaining)) {
+        return true;  // Power-on or other reset: always do the full start-up
+    }
+
+    #if defined(ESP32)
+    // A pin wake is real work only if the pin is still at its wake level
+    esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+    if (cause == ESP_SLEEP_WAKEUP_EXT0 || cause == ESP_SLEEP_WAKEUP_EXT1) {
+        if (state.wakePin == NO_WAKE_PIN || digitalRead(state.wakePin) == state.wakeLevel) {
+            return true;
+        }
+        return remaining <= ESP_LOW_POWER_SENSOR_WAKE_TOLERANCE_MS;
+    }
+    #endif
+
+    return remaining <= ESP_LOW_POWER_SENSOR_WAKE_TOLERANCE_MS;
+}
+
+bool armWakePin(uint8_t pin, bool level) {
+    if (pin == NO_WAKE_PIN) {
+        return true;
+    }
+
+    #if ESP_LOW_POWER_SENSOR_HAS_EXT0_WAKE
+    return rtc_gpio_is_valid_gpio(static_cast<gpio_num_t>(pin)) &&
+           esp_sleep_enable_ext0_wakeup(static_cast<gpio_num_t>(pin), level ? 1 : 0) == ESP_OK;
+    #else
+    (void)level;
+    return false;
+    #endif
+}
+
+} // namespace FastWake
+
+#if ESP_LOW_POWER_SENSOR_HAS_EXT0_WAKE && defined(ESP_LOW_POWER_SENSOR_WAKE_STUB) && __has_include(<esp_wake_stub.h>)
+#include <esp_wake_stub.h>
+#include <soc/rtc.h>
+#include <soc/rtc_io_reg.h>
+
+// Runs from RTC fast memory before the bootloader. Only RTC memory and
+// registers may be touched here.
+void RTC_IRAM_ATTR esp_wake_deep_sleep(void) {
+    esp_default_wake_deep_sleep();
+
+    const FastWake::State* state =
+        reinterpret_cast<const FastWake::State*>(&RtcMemory::rtcArena[RtcMemory::WAKE_OFFSET]);
+    if (state->magic != WAKE_MAGIC || state->rtcIoNum == 0xFF ||
+        !(esp_wake_stub_get_wakeup_cause() & RTC_EXT0_TRIG_EN)) {
+        return;
+    }
+
+    uint32_t level = (REG_GET_FIELD(RTC_GPIO_IN_REG, RTC_GPIO_IN_NEXT) >> state->rtcIoNum) & 1;
+    if (level != state->wakeLevel) {
+        // Bounce: the timer target and wake sources armed before the sleep
+        // are still set, so sleeping again resumes the original period
+        esp_wake_stub_sleep(&esp_wake_deep_sleep);
+    }
+}
+#endif
@@ -0,0 +1,96 @@
+#ifndef FAST_WAKE_H
+#define FAST_WAKE_H
+
+#include <Arduino.h>
+
+#if defined(ESP32) && __has_include(<soc/soc_caps.h>)
+#include <soc/soc_caps.h>
+#endif
+
+// Chips with EXT0 (single RTC IO) wake-up; ESP32-C3 and similar have none
+#if defined(SOC_PM_SUPPORT_EXT0_WAKEUP) || defined(SOC_PM_SUPPORT_EXT_WAKEUP)
+#define ESP_LOW_POWER_SENSOR_HAS_EXT0_WAKE 1
+#else
+#define ESP_LOW_POWER_SENSOR_HAS_EXT0_WAKE 0
+#endif
+
+#ifndef ESP_LOW_POWER_SENSOR_WAKE_TOLERANCE_MS
+#define ESP_LOW_POWER_SENSOR_WAKE_TOLERANCE_MS 10  ///< A wake this close to the due time counts as due
+#endif
+
+/**
+ * @namespace FastWake
+ * @brief Sleep state kept across deep sleep so a wake can be judged before any setup runs.
+ *
+ * Before deep sleep, ESPLowPowerSensor records when it went to sleep, for how
+ * long, and which pin (if any) may wake it. After the wake, workDue() decides
+ * from that record and the wake cause whether any work is due: a timer wake
+ * that came early, or a pin wake whose pin has already returned to its idle
+ * level (a bounce), is not. Such wakes go straight back to sleep for the rest
+ * of the original period.
+ *
+ * On ESP32 the elapsed time is read from the RTC timer, which keeps running in
+ * deep sleep. ESP8266 can only wake from the timer, so the requested sleep
+ * time is taken as the elapsed time.
+ *
+ * Defining ESP_LOW_POWER_SENSOR_WAKE_STUB on ESP32 with ESP-IDF 5 or later also
+ * installs a deep-sleep wake stub that rejects pin bounces from RTC memory
+ * before the bootloader runs.
+ */
+namespace FastWake {
+    constexpr uint8_t NO_WAKE_PIN = 0xFF;
+
+    /** @brief Raw layout kept in RTC memory. */
+    struct State {
+        uint32_t magic;
+        uint32_t sleepMs;       ///< Requested sleep time
+        uint64_t sleepStartUs;  ///< RTC time when sleep started (ESP32)
+        uint8_t wakePin;        ///< GPIO that may wake the chip, or NO_WAKE_PIN
+        uint8_t wakeLevel;      ///< Level on wakePin that wakes the chip
+        uint8_t rtcIoNum;       ///< RTC IO number of wakePin, for the wake stub
+        uint8_t reserved;
+        uint32_t slackMs;       ///< Part of sleepMs after the end of the scheduled period
+        uint32_t checksum;
+    };
+
+    /**
+     * @brief Records the sleep about to start.
+     * @param sleepMs Requested sleep time in milliseconds.
+     * @param wakePin GPIO that may wake the chip, or NO_WAKE_PIN.
+     * @param wakeLevel Level on wakePin that wakes the chip.
+     * @param slackMs Part of sleepMs after the end of the scheduled period, e.g. uplink jitter.
+     */
+    void save(unsigned long sleepMs, uint8_t wakePin, bool wakeLevel, unsigned long slackMs = 0);
+
+    /**
+     * @brief Loads the state recorded before the last deep sleep.
+     * @param[out] state The recorded state.
+     * @param[out] remaining Milliseconds left of the recorded sleep.
+     * @return True if this is a deep-sleep wake with a valid record.
+     */
+    bool load(State& state, unsigned long& remaining);
+
+    /**
+     * @brief Decides whether the current wake has any work to do.
+     * @param[out] state The state recorded before the sleep, when no work is due.
+     * @param[out] remaining Milliseconds left of the recorded sleep, when no work is due.
+     * @return False only for a deep-sleep wake that is early or caused by a pin bounce.
+     */
+    bool workDue(State& state, unsigned long& remaining);
+
+    /**
+     * @brief Arms a pin to wake the chip from the next deep sleep.
+     * @param pin GPIO to arm, or NO_WAKE_PIN for none.
+     * @param level Level that wakes the chip.
+     * @return True if armed (or no pin given), false if the chip cannot wake on this pin.
+     */
+    bool armWakePin(uint8_t pin, bool level);
+
+    /**
+     * @brief Gets the RTC time, which keeps counting during deep sleep.
+     * @return Microseconds since power-on (ESP32), or zero (ESP8266).
+     */
+    uint64_t rtcMicros();
+}
+
+#endif // FAST_WAKE_H
@@ -0,0 +1,75 @@
+#include "LoopbackTransport.h"
+#include <algorithm>
+
+bool LoopbackTransport::begin() {
+    if (!_active) {
+        _active = true;
+        _activeSince = millis();
+    }
+    return true;
+}
+
+void LoopbackTransport::end() {
+    if (_active) {
+        _radioOnTotal += millis() - _activeSince;
+        _active = false;
+    }
+    _ackPending = false;
+}
+
+unsigned long LoopbackTransport::radioOnMs() const {
+    return _radioOnTotal + (_active ? millis() - _activeSince : 0);
+}
+
+bool LoopbackTransport::send(const uint8_t* frame, size_t length) {
+    if (!_active || length > MAX_FRAME) {
+        return false;
+    }
+    if (dropFrames > 0) {
+        dropFrames--;
+        return true;  // Sent, but lost on the air
+    }
+
+    uint8_t ack[ReportLink::ACK_SIZE];
+    if (ReportLink::makeAck(frame, length, ack) == 0) {
+        return true;  // The gateway ignores anything but data frames
+    }
+
+    // The gateway acks resends too, but keeps their records only once
+    uint32_t nodeId = static_cast<uint32_t>(ack[2]) | static_cast<uint32_t>(ack[3]) << 8 |
+                      static_cast<uint32_t>(ack[4]) << 16 | static_cast<uint32_t>(ack[5]) << 24;
+    if (_gatewayHasFrame && nodeId == _lastNodeId && ack[1] == _lastSequence) {
+        _duplicates++;
+    } else {
+        _gatewayHasFrame = true;
+        _lastNodeId = nodeId;
+        _lastSequence = ack[1];
+        _framesReceived++;
+
+        const uint8_t* record;
+        size_t recordLength;
+        for (size_t i = 0; ReportLink::readRecord(frame, length, i, record, recordLength); ++i) {
+            _recordsReceived++;
+            _lastRecordLength = std::min(recordLength, RECORD_SIZE);
+            std::copy(record, record + _lastRecordLength, _lastRecord);
+        }
+    }
+
+    if (dropAcks > 0) {
+        dropAcks--;
+        return true;
+    }
+    std::copy(ack, ack + sizeof(ack), _ack);
+    _ackPending = true;
+    _ackAt = millis() + latencyMs;
+    return true;
+}
+
+size_t LoopbackTransport::receive(uint8_t* buffer, size_t size) {
+    if (!_ackPending || static_cast<long>(millis() - _ackAt) < 0 || size < sizeof(_ack)) {
+        return 0;
+    }
+    _ackPending = false;
+    std::copy(_ack, _ack + sizeof(_ack), buffer);
+    return sizeof(_ack);
+}
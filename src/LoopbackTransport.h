@@ -0,0 +1,73 @@
+#ifndef LOOPBACK_TRANSPORT_H
+#define LOOPBACK_TRANSPORT_H
+
+#include <Arduino.h>
+#include "Transport.h"
+#include "ReportLink.h"
+
+/**
+ * @class LoopbackTransport
+ * @brief In-memory transport with a built-in gateway, for testing without radios.
+ *
+ * Each data frame sent is handed to a stand-in gateway that keeps the
+ * records, drops resends it already has and queues an ack, which becomes
+ * receivable latencyMs later. Frames and acks can be dropped on purpose to
+ * exercise retries. Time the "radio" spends between begin() and end() is
+ * counted.
+ */
+class LoopbackTransport : public Transport {
+public:
+    static constexpr size_t MAX_FRAME = 250;
+    static constexpr size_t RECORD_SIZE = 32;  ///< Bytes of the last record kept for inspection
+
+    unsigned long latencyMs = 2;  ///< Delay before the ack can be received
+    uint8_t dropFrames = 0;       ///< Number of coming data frames the gateway never sees
+    uint8_t dropAcks = 0;         ///< Number of coming acks that are lost
+
+    bool begin() override;
+    void end() override;
+    size_t maxFrameSize() const override { return MAX_FRAME; }
+    bool send(const uint8_t* frame, size_t length) override;
+    size_t receive(uint8_t* buffer, size_t size) override;
+
+    bool isActive() const { return _active; }
+
+    /** @brief Number of data frames the gateway accepted, not counting resends. */
+    uint32_t framesReceived() const { return _framesReceived; }
+
+    /** @brief Number of resends the gateway dropped. */
+    uint32_t duplicates() const { return _duplicates; }
+
+    /** @brief Number of records in the accepted frames. */
+    uint32_t recordsReceived() const { return _recordsReceived; }
+
+    /**
+     * @brief Gets the last record the gateway accepted.
+     * @param[out] length Number of bytes kept; longer records are cut to RECORD_SIZE.
+     * @return The record bytes.
+     */
+    const uint8_t* lastRecord(size_t& length) const { length = _lastRecordLength; return _lastRecord; }
+
+    /** @brief Total time between begin() and end() calls, in milliseconds. */
+    unsigned long radioOnMs() const;
+
+private:
+    bool _active = false;
+    unsigned long _activeSince = 0;
+    unsigned long _radioOnTotal = 0;
+
+    bool _gatewayHasFrame = false;
+    uint8_t _lastSequence = 0;
+    uint32_t _lastNodeId = 0;
+    uint32_t _framesReceived = 0;
+    uint32_t _duplicates = 0;
+    uint32_t _recordsReceived = 0;
+    uint8_t _lastRecord[RECORD_SIZE] = {};
+    size_t _lastRecordLength = 0;
+
+    uint8_t _ack[ReportLink::ACK_SIZE] = {};
+    bool _ackPending = false;
+    unsigned long _ackAt = 0;
+};
+
+#endif // LOOPBACK_TRANSPORT_H
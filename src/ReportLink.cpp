@@ -0,0 +1,174 @@
+#include "ReportLink.h"
+#include <algorithm>
+
+namespace {
+    // Byte offsets within a frame
+    constexpr size_t TYPE = 0;
+    constexpr size_t SEQUENCE = 1;
+    constexpr size_t NODE_ID = 2;
+    constexpr size_t RECORD_COUNT = 6;
+
+    constexpr size_t MAX_RECORDS = 255;
+
+    uint32_t readNodeId(const uint8_t* frame) {
+        return static_cast<uint32_t>(frame[NODE_ID]) |
+               static_cast<uint32_t>(frame[NODE_ID + 1]) << 8 |
+               static_cast<uint32_t>(frame[NODE_ID + 2]) << 16 |
+               static_cast<uint32_t>(frame[NODE_ID + 3]) << 24;
+    }
+
+    bool isDataFrame(const uint8_t* frame, size_t length) {
+        return frame != nullptr && length >= ReportLink::HEADER_SIZE && frame[TYPE] == ReportLink::FRAME_DATA;
+    }
+}
+
+ReportLink::Config ReportLink::defaults() {
+    Config config = {
+        20,  // ackTimeoutMs: ESP-NOW round trips take a few milliseconds
+        4    // maxAttempts
+    };
+    return config;
+}
+
+ReportLink::ReportLink()
+    : _transport(nullptr),
+      _config(defaults()),
+      _stats(),
+      _nodeId(0),
+      _sequence(0),
+      _length(0),
+      _records(0),
+      _sent(false) {
+}
+
+size_t ReportLink::frameLimit() const {
+    size_t limit = sizeof(_frame);
+    if (_transport != nullptr) {
+        limit = std::min(limit, _transport->maxFrameSize());
+    }
+    return limit;
+}
+
+void ReportLink::startFrame() {
+    if (_sent) {
+        _sequence++;
+        _sent = false;
+    }
+    _length = HEADER_SIZE;
+    _records = 0;
+}
+
+bool ReportLink::queue(const uint8_t* data, size_t length) {
+    if (data == nullptr && length > 0) {
+        return false;
+    }
+    if (HEADER_SIZE + 1 + length > frameLimit() || length > 0xFF) {
+        Serial.println("Report too large for one frame");
+        return false;
+    }
+
+    bool delivered = true;
+    if (_records > 0 && (_length + 1 + length > frameLimit() || _records == MAX_RECORDS)) {
+        delivered = flush();
+        if (!delivered) {
+            discard();
+        }
+    }
+    if (_records == 0) {
+        startFrame();
+    } else if (_sent) {
+        // The gateway may hold this frame with only the ack lost, and would
+        // drop a longer copy under the same sequence number as a resend
+        _sequence++;
+        _sent = false;
+    }
+
+    _frame[_length++] = static_cast<uint8_t>(length);
+    std::copy(data, data + length, _frame + _length);
+    _length += length;
+    _records++;
+    return delivered;
+}
+
+bool ReportLink::flush() {
+    if (_records == 0) {
+        return true;
+    }
+    if (_transport == nullptr) {
+        return false;
+    }
+
+    _frame[TYPE] = FRAME_DATA;
+    _frame[SEQUENCE] = _sequence;
+    for (size_t i = 0; i < 4; ++i) {
+        _frame[NODE_ID + i] = static_cast<uint8_t>(_nodeId >> (8 * i));
+    }
+    _frame[RECORD_COUNT] = _records;
+    _sent = true;
+
+    for (uint8_t attempt = 0; attempt < _config.maxAttempts; ++attempt) {
+        if (attempt > 0) {
+            _stats.retries++;
+        }
+        if (_transport->send(_frame, _length) && waitForAck()) {
+            _stats.framesDelivered++;
+            _records = 0;
+            _length = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ReportLink::discard() {
+    if (_records > 0) {
+        _stats.framesLost++;
+        startFrame();
+    }
+}
+
+bool ReportLink::waitForAck() {
+    uint8_t reply[ACK_SIZE];
+    unsigned long start = millis();
+    do {
+        // Anything but our ack (e.g. a late ack of an earlier send) is skipped
+        size_t length;
+        while ((length = _transport->receive(reply, sizeof(reply))) > 0) {
+            if (length == ACK_SIZE && reply[TYPE] == FRAME_ACK && reply[SEQUENCE] == _sequence &&
+                readNodeId(reply) == _nodeId) {
+                return true;
+            }
+        }
+        delay(1);
+    } while (millis() - start < _config.ackTimeoutMs);
+    return false;
+}
+
+size_t ReportLink::makeAck(const uint8_t* frame, size_t length, uint8_t* ack) {
+    if (!isDataFrame(frame, length) || ack == nullptr) {
+        return 0;
+    }
+    ack[TYPE] = FRAME_ACK;
+    std::copy(frame + SEQUENCE, frame + ACK_SIZE, ack + SEQUENCE);
+    return ACK_SIZE;
+}
+
+bool ReportLink::readRecord(const uint8_t* frame, size_t length, size_t index,
+                            const uint8_t*& record, size_t& recordLength) {
+    if (!isDataFrame(frame, length) || index >= frame[RECORD_COUNT]) {
+        return false;
+    }
+
+    size_t offset = HEADER_SIZE;
+    for (size_t i = 0; ; ++i) {
+        if (offset >= length || offset + 1 + frame[offset] > length) {
+            return false;  // Truncated frame
+        }
+        if (i == index) {
+            record = frame + offset + 1;
+            recordLength = frame[offset];
+            return true;
+        }
+        offset += 1 + frame[offset];
+    }
+}
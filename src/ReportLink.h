@@ -0,0 +1,153 @@
+#ifndef REPORT_LINK_H
+#define REPORT_LINK_H
+
+#include <Arduino.h>
+#include "Transport.h"
+
+#ifndef ESP_LOW_POWER_SENSOR_REPORT_FRAME
+#define ESP_LOW_POWER_SENSOR_REPORT_FRAME 250  ///< Largest report frame; 250 bytes is the ESP-NOW payload limit
+#endif
+
+/**
+ * @class ReportLink
+ * @brief Batches short reports into frames and delivers them over a Transport with acks and retries.
+ *
+ * Reports queued during a wake are packed into one frame. flush() sends the
+ * frame and waits a few milliseconds for the gateway's ack, resending up to
+ * maxAttempts times. Each new frame takes the next sequence number while
+ * resends keep it, so the gateway can drop a frame it already has when only
+ * the ack was lost. A frame is never changed once sent: a report queued after
+ * a failed flush() goes out with the unacknowledged ones under a new sequence
+ * number, so the gateway may get those twice but never drops the new report.
+ *
+ * Data frame: type (FRAME_DATA), sequence, node id (4 bytes, little-endian),
+ * record count, then each record as a length byte followed by its bytes.
+ * Ack frame: type (FRAME_ACK), sequence, node id. A gateway answers each data
+ * frame with makeAck() and reads its records with readRecord().
+ */
+class ReportLink {
+public:
+    static constexpr uint8_t FRAME_DATA = 0xD1;
+    static constexpr uint8_t FRAME_ACK = 0xA1;
+    static constexpr size_t HEADER_SIZE = 7;
+    static constexpr size_t ACK_SIZE = 6;
+
+    /**
+     * @struct Config
+     * @brief Acknowledgement settings.
+     */
+    struct Config {
+        unsigned long ackTimeoutMs;  ///< Longest wait for the ack of one send
+        uint8_t maxAttempts;         ///< Sends of a frame before it is given up
+    };
+
+    /**
+     * @struct Stats
+     * @brief Delivery counters since the link was created.
+     */
+    struct Stats {
+        uint32_t framesDelivered;  ///< Frames the gateway acknowledged
+        uint32_t retries;          ///< Sends after the first for the same frame
+        uint32_t framesLost;       ///< Frames given up after maxAttempts
+    };
+
+    /**
+     * @brief Gets the default settings: four sends with a 20 ms ack wait each.
+     */
+    static Config defaults();
+
+    ReportLink();
+
+    /**
+     * @brief Sets the transport frames are sent over. The caller starts and stops it.
+     * @param transport The transport, or nullptr for none.
+     */
+    void setTransport(Transport* transport) { _transport = transport; }
+
+    /**
+     * @brief Sets the node id carried in every frame.
+     * @param id The node id.
+     */
+    void setNodeId(uint32_t id) { _nodeId = id; }
+
+    /**
+     * @brief Sets the next sequence number. Seed it randomly at boot so a
+     * restarted node is not taken for a resend of its last frame.
+     * @param sequence The sequence number.
+     */
+    void setSequence(uint8_t sequence) { _sequence = sequence; }
+
+    void setConfig(const Config& config) { _config = config; }
+    const Config& config() const { return _config; }
+
+    /**
+     * @brief Adds a report to the current frame, sending the frame first if the report does not fit.
+     *
+     * If that send fails the unsent frame is dropped to make room.
+     *
+     * @param data The report.
+     * @param length The report length in bytes.
+     * @return True if the report was queued and any frame sent to make room was acknowledged.
+     */
+    bool queue(const uint8_t* data, size_t length);
+
+    /**
+     * @brief Sends the current frame and waits for its ack, resending as needed.
+     *
+     * A frame that is not acknowledged stays queued for the next flush().
+     *
+     * @return True if the frame was acknowledged or nothing was queued, false otherwise.
+     */
+    bool flush();
+
+    /**
+     * @brief Gives up the queued reports, counting their frame as lost.
+     */
+    void discard();
+
+    /**
+     * @brief Gets the number of reports waiting to be sent.
+     * @return The number of queued reports.
+     */
+    size_t pending() const { return _records; }
+
+    const Stats& stats() const { return _stats; }
+
+    /**
+     * @brief Writes the ack for a received data frame (gateway side).
+     * @param frame The received frame.
+     * @param length The frame length in bytes.
+     * @param[out] ack Where to write the ack; at least ACK_SIZE bytes.
+     * @return ACK_SIZE, or zero if the frame is not a valid data frame.
+     */
+    static size_t makeAck(const uint8_t* frame, size_t length, uint8_t* ack);
+
+    /**
+     * @brief Finds a record in a received data frame (gateway side).
+     * @param frame The received frame.
+     * @param length The frame length in bytes.
+     * @param index The record, from zero.
+     * @param[out] record Start of the record within the frame.
+     * @param[out] recordLength The record length in bytes.
+     * @return True if the record exists, false otherwise.
+     */
+    static bool readRecord(const uint8_t* frame, size_t length, size_t index,
+                           const uint8_t*& record, size_t& recordLength);
+
+private:
+    Transport* _transport;
+    Config _config;
+    Stats _stats;
+    uint32_t _nodeId;
+    uint8_t _sequence;
+    uint8_t _frame[ESP_LOW_POWER_SENSOR_REPORT_FRAME];
+    size_t _length;
+    uint8_t _records;
+    bool _sent;  ///< Whether the current frame has been sent, acknowledged or not
+
+    size_t frameLimit() const;
+    void startFrame();
+    bool waitForAck();
+};
+
+#endif // REPORT_LINK_H
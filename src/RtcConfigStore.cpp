@@ -0,0 +1,72 @@
+#include "RtcConfigStore.h"
+#include "RtcMemory.h"
+#include <stddef.h>
+#include <string.h>
+
+namespace {
+    constexpr uint32_t CONFIG_MAGIC = 0x4C505343;  // "LPSC"
+}
+
+static_assert(sizeof(RtcConfigStore::Data) <= (RtcMemory::POLICY_OFFSET - RtcMemory::CONFIG_OFFSET) * RtcMemory::BLOCK_SIZE,
+              "RtcConfigStore does not fit its RTC memory blocks");
+
+RtcConfigStore::RtcConfigStore() {
+    memset(&_data, 0, sizeof(_data));
+}
+
+bool RtcConfigStore::load() {
+    // Anything other than a deep-sleep wake starts from the sketch's own configuration
+    if (!RtcMemory::wokeFromDeepSleep()) {
+        clear();
+        return false;
+    }
+
+    if (!RtcMemory::read(RtcMemory::CONFIG_OFFSET, &_data, sizeof(_data)) ||
+        _data.magic != CONFIG_MAGIC || _data.count > SLOTS || _data.checksum != computeChecksum(_data)) {
+        memset(&_data, 0, sizeof(_data));
+        return false;
+    }
+    return _data.count > 0 || _data.singleInterval != 0;
+}
+
+void RtcConfigStore::save() const {
+    Data data = _data;
+    data.magic = CONFIG_MAGIC;
+    data.checksum = computeChecksum(data);
+    RtcMemory::write(RtcMemory::CONFIG_OFFSET, &data, sizeof(data));
+}
+
+void RtcConfigStore::clear() {
+    memset(&_data, 0, sizeof(_data));
+    save();
+}
+
+RtcConfigStore::Record* RtcConfigStore::recordFor(uint16_t id) {
+    for (size_t i = 0; i < _data.count; ++i) {
+        if (_data.records[i].id == id) {
+            return &_data.records[i];
+        }
+    }
+
+    if (_data.count >= SLOTS) {
+        return nullptr;
+    }
+
+    Record* record = &_data.records[_data.count++];
+    record->id = id;
+    record->flags = 0;
+    record->reserved = 0;
+    record->value = 0;
+    return record;
+}
+
+uint32_t RtcConfigStore::computeChecksum(const Data& data) {
+    // FNV-1a over everything after the checksum field
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&data.singleInterval);
+    size_t length = sizeof(Data) - offsetof(Data, singleInterval);
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
@@ -0,0 +1,85 @@
+#ifndef RTC_CONFIG_STORE_H
+#define RTC_CONFIG_STORE_H
+
+#include <Arduino.h>
+
+#ifndef ESP_LOW_POWER_SENSOR_PERSISTED_CONFIG_SLOTS
+#define ESP_LOW_POWER_SENSOR_PERSISTED_CONFIG_SLOTS 16
+#endif
+
+/**
+ * @class RtcConfigStore
+ * @brief Keeps runtime sensor configuration changes in RTC memory across deep sleep.
+ *
+ * Each sensor that has been reconfigured at runtime has one record holding its
+ * latest enabled state, interval/threshold and whether it was removed. After a
+ * deep-sleep wake the sketch re-adds its sensors with their compile-time values,
+ * and the records are replayed on top so runtime changes survive the reset.
+ *
+ * The records live in the RtcMemory config blocks, guarded by a checksum.
+ */
+class RtcConfigStore {
+public:
+    static constexpr size_t SLOTS = ESP_LOW_POWER_SENSOR_PERSISTED_CONFIG_SLOTS;
+
+    enum RecordFlag : uint8_t {
+        RECORD_HAS_ENABLED = 0x01,  ///< The enabled state was changed
+        RECORD_ENABLED     = 0x02,  ///< Latest enabled state
+        RECORD_HAS_VALUE   = 0x04,  ///< The interval/threshold was changed
+        RECORD_REMOVED     = 0x08   ///< The sensor was removed
+    };
+
+    struct Record {
+        uint16_t id;     ///< Sensor id
+        uint8_t flags;   ///< RecordFlag bits
+        uint8_t reserved;
+        uint32_t value;  ///< Interval or threshold when RECORD_HAS_VALUE is set
+    };
+
+    RtcConfigStore();
+
+    /**
+     * @brief Loads the persisted records.
+     * @return True if valid records from before the last deep sleep were found.
+     */
+    bool load();
+
+    /**
+     * @brief Writes the records to RTC memory.
+     */
+    void save() const;
+
+    /**
+     * @brief Drops all records, in memory and in RTC memory.
+     */
+    void clear();
+
+    /**
+     * @brief Finds the record for a sensor, creating it if needed.
+     * @param id The sensor id.
+     * @return The record, or nullptr if all slots are in use.
+     */
+    Record* recordFor(uint16_t id);
+
+    size_t size() const { return _data.count; }
+    const Record& record(size_t index) const { return _data.records[index]; }
+
+    uint32_t singleInterval() const { return _data.singleInterval; }
+    void setSingleInterval(uint32_t interval) { _data.singleInterval = interval; }
+
+    /** @brief Raw layout kept in RTC memory. */
+    struct Data {
+        uint32_t magic;
+        uint32_t checksum;
+        uint32_t singleInterval;  ///< Zero when the single interval was not changed
+        uint32_t count;
+        Record records[SLOTS];
+    };
+
+private:
+    Data _data;
+
+    static uint32_t computeChecksum(const Data& data);
+};
+
+#endif // RTC_CONFIG_STORE_H
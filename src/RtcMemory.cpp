@@ -0,0 +1,57 @@
+#include "RtcMemory.h"
+#include <string.h>
+
+#if defined(ESP8266)
+extern "C" {
+#include <user_interface.h>
+}
+#endif
+
+#if defined(ESP32)
+RTC_DATA_ATTR uint32_t RtcMemory::rtcArena[RtcMemory::BLOCK_COUNT];
+#endif
+
+namespace {
+    bool validRange(uint32_t offset, size_t size) {
+        return size % RtcMemory::BLOCK_SIZE == 0 &&
+               offset + size / RtcMemory::BLOCK_SIZE <= RtcMemory::BLOCK_COUNT;
+    }
+}
+
+namespace RtcMemory {
+
+bool read(uint32_t offset, void* data, size_t size) {
+    if (!validRange(offset, size)) {
+        return false;
+    }
+
+    #if defined(ESP32)
+    memcpy(data, &rtcArena[offset], size);
+    return true;
+    #elif defined(ESP8266)
+    return ESP.rtcUserMemoryRead(offset, static_cast<uint32_t*>(data), size);
+    #endif
+}
+
+bool write(uint32_t offset, const void* data, size_t size) {
+    if (!validRange(offset, size)) {
+        return false;
+    }
+
+    #if defined(ESP32)
+    memcpy(&rtcArena[offset], data, size);
+    return true;
+    #elif defined(ESP8266)
+    return ESP.rtcUserMemoryWrite(offset, static_cast<uint32_t*>(const_cast<void*>(data)), size);
+    #endif
+}
+
+bool wokeFromDeepSleep() {
+    #if defined(ESP32)
+    return esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_UNDEFINED;
+    #elif defined(ESP8266)
+    return ESP.getResetInfoPtr()->reason == REASON_DEEP_SLEEP_AWAKE;
+    #endif
+}
+
+} // namespace RtcMemory
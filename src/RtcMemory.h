@@ -0,0 +1,63 @@
+#ifndef RTC_MEMORY_H
+#define RTC_MEMORY_H
+
+#include <Arduino.h>
+
+/**
+ * @namespace RtcMemory
+ * @brief Word-addressed access to memory that survives deep sleep.
+ *
+ * ESP8266 exposes 512 bytes of RTC user memory addressed in 4-byte blocks.
+ * ESP32 has no such API, so an RTC_DATA_ATTR arena of the same shape is used.
+ * Each library component owns a fixed block range:
+ *
+ *   Blocks  0-35  RtcConfigStore (runtime configuration changes)
+ *   Blocks 36-39  BatteryPolicy state
+ *   Blocks 40-47  FastWake sleep state
+ *   Blocks 48-127 TraceRecorder ring (ESP8266; ESP32 keeps a larger ring of its own)
+ */
+namespace RtcMemory {
+    constexpr size_t BLOCK_SIZE = 4;
+    constexpr size_t BLOCK_COUNT = 128;
+
+    constexpr uint32_t CONFIG_OFFSET = 0;   ///< First block of RtcConfigStore
+    constexpr uint32_t POLICY_OFFSET = 36;  ///< First block of the BatteryPolicy state
+    constexpr uint32_t WAKE_OFFSET = 40;    ///< First block of the FastWake sleep state
+    constexpr uint32_t TRACE_OFFSET = 48;   ///< First block of the TraceRecorder ring (ESP8266)
+
+    #if defined(ESP32)
+    /**
+     * @brief The RTC arena itself, for the deep-sleep wake stub, which runs
+     * before flash is available and cannot call read().
+     */
+    extern uint32_t rtcArena[BLOCK_COUNT];
+    #endif
+
+    /**
+     * @brief Copies data out of RTC memory.
+     * @param offset First block to read.
+     * @param data Destination; must be 4-byte aligned.
+     * @param size Number of bytes, a multiple of 4.
+     * @return True if the range is valid, false otherwise.
+     */
+    bool read(uint32_t offset, void* data, size_t size);
+
+    /**
+     * @brief Copies data into RTC memory.
+     * @param offset First block to write.
+     * @param data Source; must be 4-byte aligned.
+     * @param size Number of bytes, a multiple of 4.
+     * @return True if the range is valid, false otherwise.
+     */
+    bool write(uint32_t offset, const void* data, size_t size);
+
+    /**
+     * @brief Checks if the last reset was a wake from deep sleep.
+     *
+     * RTC memory only holds data written before the last sleep after such a
+     * wake; after power-on or any other reset it must be ignored.
+     */
+    bool wokeFromDeepSleep();
+}
+
+#endif // RTC_MEMORY_H
@@ -0,0 +1,221 @@
+#include "SensorRegistry.h"
+#include <algorithm>
+
+SensorRegistry::SensorRegistry(size_t maxSensors)
+    : _maxSensors(std::min<size_t>(maxSensors, INVALID_ID)),
+      _count(0) {
+}
+
+SensorRegistry::SensorId SensorRegistry::add(unsigned long interval, unsigned long nextDue, bool polled) {
+    if (_count >= _maxSensors) {
+        return INVALID_ID;
+    }
+
+    SensorId id;
+    if (!_freeSlots.empty()) {
+        id = _freeSlots.back();
+        _freeSlots.pop_back();
+    } else {
+        id = static_cast<SensorId>(_flags.size());
+        _nextDue.push_back(0);
+        _interval.push_back(0);
+        _flags.push_back(0);
+        _heapPos.push_back(NOT_IN_HEAP);
+        _polledPos.push_back(NOT_POLLED);
+    }
+
+    _nextDue[id] = nextDue;
+    _interval[id] = interval;
+    _flags[id] = polled ? (FLAG_ACTIVE | FLAG_POLLED) : FLAG_ACTIVE;
+    _heapPos[id] = NOT_IN_HEAP;
+    _polledPos[id] = NOT_POLLED;
+    syncMembership(id);
+
+    ++_count;
+    return id;
+}
+
+bool SensorRegistry::remove(SensorId id) {
+    if (!contains(id)) {
+        return false;
+    }
+
+    _flags[id] |= FLAG_DISABLED;
+    syncMembership(id);
+
+    _flags[id] = 0;
+    _freeSlots.push_back(id);
+    --_count;
+    return true;
+}
+
+bool SensorRegistry::updateInterval(SensorId id, unsigned long interval) {
+    if (!contains(id)) {
+        return false;
+    }
+
+    // Keep the last execution time (nextDue - interval) and move the due time
+    unsigned long lastExecution = _nextDue[id] - _interval[id];
+    _interval[id] = interval;
+    _nextDue[id] = lastExecution + interval;
+
+    if (_flags[id] & FLAG_TIMED) {
+        siftUp(_heapPos[id]);
+        siftDown(_heapPos[id]);
+    }
+    syncMembership(id);
+    return true;
+}
+
+bool SensorRegistry::setEnabled(SensorId id, bool enabled) {
+    if (!contains(id)) {
+        return false;
+    }
+
+    if (enabled) {
+        _flags[id] &= ~FLAG_DISABLED;
+    } else {
+        _flags[id] |= FLAG_DISABLED;
+    }
+    syncMembership(id);
+    return true;
+}
+
+bool SensorRegistry::setOptional(SensorId id, bool optional) {
+    if (!contains(id)) {
+        return false;
+    }
+
+    if (optional) {
+        _flags[id] |= FLAG_OPTIONAL;
+    } else {
+        _flags[id] &= ~FLAG_OPTIONAL;
+    }
+    return true;
+}
+
+void SensorRegistry::reschedule(SensorId id, unsigned long nextDue) {
+    if (!contains(id)) {
+        return;
+    }
+
+    unsigned long previous = _nextDue[id];
+    _nextDue[id] = nextDue;
+    if (!(_flags[id] & FLAG_TIMED)) {
+        return;
+    }
+
+    if (static_cast<long>(nextDue - previous) < 0) {
+        siftUp(_heapPos[id]);
+    } else {
+        siftDown(_heapPos[id]);
+    }
+}
+
+SensorRegistry::SensorId SensorRegistry::peekDue(unsigned long now) const {
+    if (_heap.empty()) {
+        return INVALID_ID;
+    }
+    SensorId top = _heap.front();
+    return static_cast<long>(now - _nextDue[top]) >= 0 ? top : INVALID_ID;
+}
+
+bool SensorRegistry::timeUntilNextDue(unsigned long now, unsigned long& remaining) const {
+    if (_heap.empty()) {
+        return false;
+    }
+    long delta = static_cast<long>(_nextDue[_heap.front()] - now);
+    remaining = delta > 0 ? static_cast<unsigned long>(delta) : 0;
+    return true;
+}
+
+bool SensorRegistry::dueBefore(SensorId a, SensorId b) const {
+    long delta = static_cast<long>(_nextDue[a] - _nextDue[b]);
+    // Ties are broken by id so sensors due together run in registration order
+    return delta < 0 || (delta == 0 && a < b);
+}
+
+void SensorRegistry::syncMembership(SensorId id) {
+    uint8_t flags = _flags[id];
+    bool enabled = !(flags & FLAG_DISABLED);
+
+    bool wantTimed = enabled && !(flags & FLAG_POLLED) && _interval[id] > 0;
+    if (wantTimed && !(flags & FLAG_TIMED)) {
+        heapInsert(id);
+    } else if (!wantTimed && (flags & FLAG_TIMED)) {
+        heapErase(id);
+    }
+
+    bool wantPolled = enabled && (flags & FLAG_POLLED);
+    if (wantPolled && _polledPos[id] == NOT_POLLED) {
+        _polledPos[id] = static_cast<uint16_t>(_polled.size());
+        _polled.push_back(id);
+    } else if (!wantPolled && _polledPos[id] != NOT_POLLED) {
+        // Move the last entry into the gap
+        SensorId last = _polled.back();
+        _polled[_polledPos[id]] = last;
+        _polledPos[last] = _polledPos[id];
+        _polled.pop_back();
+        _polledPos[id] = NOT_POLLED;
+    }
+}
+
+void SensorRegistry::heapInsert(SensorId id) {
+    _flags[id] |= FLAG_TIMED;
+    _heapPos[id] = static_cast<uint16_t>(_heap.size());
+    _heap.push_back(id);
+    siftUp(_heap.size() - 1);
+}
+
+void SensorRegistry::heapErase(SensorId id) {
+    size_t pos = _heapPos[id];
+    size_t last = _heap.size() - 1;
+    if (pos != last) {
+        heapSwap(pos, last);
+    }
+    _heap.pop_back();
+    _heapPos[id] = NOT_IN_HEAP;
+    _flags[id] &= ~FLAG_TIMED;
+
+    if (pos < _heap.size()) {
+        siftUp(pos);
+        siftDown(pos);
+    }
+}
+
+void SensorRegistry::heapSwap(size_t a, size_t b) {
+    std::swap(_heap[a], _heap[b]);
+    _heapPos[_heap[a]] = static_cast<uint16_t>(a);
+    _heapPos[_heap[b]] = static_cast<uint16_t>(b);
+}
+
+void SensorRegistry::siftUp(size_t pos) {
+    while (pos > 0) {
+        size_t parent = (pos - 1) / 2;
+        if (!dueBefore(_heap[pos], _heap[parent])) {
+            break;
+        }
+        heapSwap(pos, parent);
+        pos = parent;
+    }
+}
+
+void SensorRegistry::siftDown(size_t pos) {
+    size_t size = _heap.size();
+    while (true) {
+        size_t smallest = pos;
+        size_t left = 2 * pos + 1;
+        size_t right = left + 1;
+        if (left < size && dueBefore(_heap[left], _heap[smallest])) {
+            smallest = left;
+        }
+        if (right < size && dueBefore(_heap[right], _heap[smallest])) {
+            smallest = right;
+        }
+        if (smallest == pos) {
+            break;
+        }
+        heapSwap(pos, smallest);
+        pos = smallest;
+    }
+}
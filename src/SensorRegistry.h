@@ -0,0 +1,165 @@
+#ifndef SENSOR_REGISTRY_H
+#define SENSOR_REGISTRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * @class SensorRegistry
+ * @brief Scheduling state for the sensors managed by ESPLowPowerSensor.
+ *
+ * The registry only holds the "hot" fields that the scheduler touches on every
+ * run (next due time, interval and flags), laid out as parallel arrays indexed
+ * by sensor id. Callbacks and trigger configuration live with the owner.
+ *
+ * Timed sensors are kept in an indexed binary min-heap ordered by due time, so
+ * finding the next due sensor is O(1) and rescheduling, adding or removing a
+ * sensor is O(log n). Pin-triggered sensors are kept in an unordered list
+ * with each sensor's position, so enabling or disabling one is O(1). Due times
+ * are compared with wrap-around safe arithmetic so the schedule survives the
+ * millis() rollover.
+ */
+class SensorRegistry {
+public:
+    using SensorId = uint16_t;
+
+    static constexpr SensorId INVALID_ID = 0xFFFF;  ///< Returned when no sensor matches
+
+    /**
+     * @enum Flag
+     * @brief Per-sensor state bits stored in the hot arrays.
+     */
+    enum Flag : uint8_t {
+        FLAG_ACTIVE = 0x01,  ///< Slot holds a registered sensor
+        FLAG_TIMED  = 0x02,  ///< Sensor is scheduled on the due-time heap
+        FLAG_POLLED = 0x04,  ///< Sensor is checked on every run (DIGITAL/ANALOG_TRIGGER)
+        FLAG_DISABLED = 0x08, ///< Sensor is registered but neither scheduled nor polled
+        FLAG_OPTIONAL = 0x10  ///< Sensor may be skipped by the battery policy
+    };
+
+    /**
+     * @brief Constructs an empty registry.
+     * @param maxSensors Upper bound on the number of simultaneously registered sensors.
+     */
+    explicit SensorRegistry(size_t maxSensors);
+
+    /**
+     * @brief Registers a sensor, reusing a free slot when one is available.
+     * @param interval Scheduling interval in milliseconds; zero leaves the sensor unscheduled.
+     * @param nextDue Time (millis) at which the sensor is first due.
+     * @param polled Whether the sensor must be checked on every run instead of being scheduled.
+     * @return The new sensor id, or INVALID_ID if the registry is full.
+     */
+    SensorId add(unsigned long interval, unsigned long nextDue, bool polled);
+
+    /**
+     * @brief Unregisters a sensor and releases its slot.
+     * @param id The sensor id.
+     * @return True if the sensor existed, false otherwise.
+     */
+    bool remove(SensorId id);
+
+    /**
+     * @brief Changes the interval of a sensor, keeping its last execution time.
+     * @param id The sensor id.
+     * @param interval The new interval in milliseconds; zero unschedules the sensor.
+     * @return True if the sensor existed, false otherwise.
+     */
+    bool updateInterval(SensorId id, unsigned long interval);
+
+    /**
+     * @brief Enables or disables a sensor without unregistering it.
+     *
+     * A disabled sensor keeps its interval and due time but is taken off the
+     * heap and the polled list until it is enabled again.
+     *
+     * @param id The sensor id.
+     * @param enabled Whether the sensor should be scheduled/polled.
+     * @return True if the sensor existed, false otherwise.
+     */
+    bool setEnabled(SensorId id, bool enabled);
+
+    bool isEnabled(SensorId id) const {
+        return contains(id) && !(_flags[id] & FLAG_DISABLED);
+    }
+
+    /**
+     * @brief Marks a sensor as optional, so it may be suppressed to save power.
+     * @param id The sensor id.
+     * @param optional Whether the sensor is optional.
+     * @return True if the sensor existed, false otherwise.
+     */
+    bool setOptional(SensorId id, bool optional);
+
+    /**
+     * @brief Moves a scheduled sensor to a new due time.
+     * @param id The sensor id.
+     * @param nextDue The new due time in milliseconds.
+     */
+    void reschedule(SensorId id, unsigned long nextDue);
+
+    /**
+     * @brief Returns the earliest scheduled sensor if it is due at the given time.
+     * @param now The current time in milliseconds.
+     * @return The due sensor id, or INVALID_ID if nothing is due.
+     */
+    SensorId peekDue(unsigned long now) const;
+
+    /**
+     * @brief Gets the number of milliseconds until the earliest scheduled sensor is due.
+     * @param now The current time in milliseconds.
+     * @param[out] remaining Time until the next due sensor (zero if already due).
+     * @return True if any sensor is scheduled, false otherwise.
+     */
+    bool timeUntilNextDue(unsigned long now, unsigned long& remaining) const;
+
+    bool contains(SensorId id) const {
+        return id < _flags.size() && (_flags[id] & FLAG_ACTIVE);
+    }
+
+    size_t size() const { return _count; }
+    size_t maxSize() const { return _maxSensors; }
+
+    /**
+     * @brief Gets the number of allocated slots; valid ids are below this value.
+     */
+    size_t slotCount() const { return _flags.size(); }
+
+    unsigned long interval(SensorId id) const { return _interval[id]; }
+    unsigned long nextDue(SensorId id) const { return _nextDue[id]; }
+    uint8_t flags(SensorId id) const { return _flags[id]; }
+
+    /**
+     * @brief Gets the ids of sensors that are checked on every run, in no particular order.
+     */
+    const std::vector<SensorId>& polled() const { return _polled; }
+
+private:
+    static constexpr uint16_t NOT_IN_HEAP = 0xFFFF;
+    static constexpr uint16_t NOT_POLLED = 0xFFFF;
+
+    size_t _maxSensors;
+    size_t _count;
+
+    // Hot scheduling state, one entry per slot
+    std::vector<unsigned long> _nextDue;
+    std::vector<unsigned long> _interval;
+    std::vector<uint8_t> _flags;
+    std::vector<uint16_t> _heapPos;
+    std::vector<uint16_t> _polledPos;
+
+    std::vector<SensorId> _heap;      ///< Timed sensors ordered by due time
+    std::vector<SensorId> _polled;    ///< Sensors checked on every run
+    std::vector<SensorId> _freeSlots; ///< Slots released by remove()
+
+    bool dueBefore(SensorId a, SensorId b) const;
+    void syncMembership(SensorId id);
+    void heapInsert(SensorId id);
+    void heapErase(SensorId id);
+    void heapSwap(size_t a, size_t b);
+    void siftUp(size_t pos);
+    void siftDown(size_t pos);
+};
+
+#endif // SENSOR_REGISTRY_H
@@ -0,0 +1,247 @@
+#include "TraceRecorder.h"
+#include "RtcMemory.h"
+#include "FastWake.h"
+#include <algorithm>
+
+namespace {
+    constexpr uint32_t TRACE_MAGIC = 0x4C505452;  // "LPTR"
+    constexpr uint8_t FORMAT_VERSION = 1;
+    constexpr size_t DUMP_HEADER_SIZE = 8;
+    constexpr unsigned long MAX_SLEEP_MS = 0xFFFFFF;
+
+    struct Header {
+        uint32_t magic;
+        uint16_t head;      ///< Slot the next event goes into
+        uint16_t count;
+        uint8_t enabled;
+        uint8_t reserved[3];
+        uint64_t epochUs;   ///< ESP8266: trace time at the last boot
+    };
+
+    static_assert(sizeof(TraceRecorder::Event) == 2 * RtcMemory::BLOCK_SIZE,
+                  "Trace events must be two RTC memory blocks");
+    static_assert(sizeof(TraceRecorder::Event) == DUMP_HEADER_SIZE,
+                  "The dump header and events share a buffer");
+
+    bool begun = false;
+
+    #if defined(ESP32)
+    constexpr uint8_t PLATFORM = 1;
+    constexpr size_t CAPACITY = ESP_LOW_POWER_SENSOR_TRACE_EVENTS;
+
+    RTC_DATA_ATTR Header rtcHeader;
+    RTC_DATA_ATTR TraceRecorder::Event rtcEvents[CAPACITY];
+
+    Header& header() { return rtcHeader; }
+    void saveHeader() {}
+    void writeEvent(size_t slot, const TraceRecorder::Event& event) { rtcEvents[slot] = event; }
+    void readEvent(size_t slot, TraceRecorder::Event& event) { event = rtcEvents[slot]; }
+    #elif defined(ESP8266)
+    // ESP8266 RTC user memory is only 512 bytes; the trace takes what the
+    // other components leave
+    constexpr uint8_t PLATFORM = 2;
+    constexpr uint32_t HEADER_BLOCKS = sizeof(Header) / RtcMemory::BLOCK_SIZE;
+    constexpr uint32_t EVENT_BLOCKS = sizeof(TraceRecorder::Event) / RtcMemory::BLOCK_SIZE;
+    constexpr size_t CAPACITY = (RtcMemory::BLOCK_COUNT - RtcMemory::TRACE_OFFSET - HEADER_BLOCKS) / EVENT_BLOCKS;
+
+    Header cachedHeader;
+    bool headerLoaded = false;
+
+    Header& header() {
+        if (!headerLoaded) {
+            RtcMemory::read(RtcMemory::TRACE_OFFSET, &cachedHeader, sizeof(cachedHeader));
+            headerLoaded = true;
+        }
+        return cachedHeader;
+    }
+
+    void saveHeader() {
+        RtcMemory::write(RtcMemory::TRACE_OFFSET, &cachedHeader, sizeof(cachedHeader));
+    }
+
+    void writeEvent(size_t slot, const TraceRecorder::Event& event) {
+        RtcMemory::write(RtcMemory::TRACE_OFFSET + HEADER_BLOCKS + slot * EVENT_BLOCKS, &event, sizeof(event));
+    }
+
+    void readEvent(size_t slot, TraceRecorder::Event& event) {
+        RtcMemory::read(RtcMemory::TRACE_OFFSET + HEADER_BLOCKS + slot * EVENT_BLOCKS, &event, sizeof(event));
+    }
+    #endif
+
+    void reset(Header& h, bool enabled) {
+        h = {};
+        h.magic = TRACE_MAGIC;
+        h.enabled = enabled ? 1 : 0;
+        saveHeader();
+    }
+
+    // Serialized form is little-endian regardless of the host
+    void encodeHeader(size_t count, uint8_t* out) {
+        for (size_t i = 0; i < 4; ++i) {
+            out[i] = static_cast<uint8_t>(TRACE_MAGIC >> (8 * i));
+        }
+        out[4] = FORMAT_VERSION;
+        out[5] = PLATFORM;
+        out[6] = static_cast<uint8_t>(count);
+        out[7] = static_cast<uint8_t>(count >> 8);
+    }
+
+    void encodeEvent(const TraceRecorder::Event& event, uint8_t* out) {
+        for (size_t i = 0; i < 4; ++i) {
+            out[i] = static_cast<uint8_t>(event.time >> (8 * i));
+        }
+        out[4] = event.type;
+        out[5] = event.arg8;
+        out[6] = static_cast<uint8_t>(event.arg16);
+        out[7] = static_cast<uint8_t>(event.arg16 >> 8);
+    }
+}
+
+namespace TraceRecorder {
+
+void begin() {
+    if (begun) {
+        return;
+    }
+    begun = true;
+
+    Header& h = header();
+    if (!RtcMemory::wokeFromDeepSleep() || h.magic != TRACE_MAGIC || h.head >= CAPACITY || h.count > CAPACITY) {
+        reset(h, false);
+    }
+}
+
+void setEnabled(bool enabled) {
+    begin();
+    header().enabled = enabled ? 1 : 0;
+    saveHeader();
+}
+
+bool isEnabled() {
+    const Header& h = header();
+    return h.magic == TRACE_MAGIC && h.enabled;
+}
+
+uint64_t nowMicros() {
+    #if defined(ESP32)
+    return FastWake::rtcMicros();
+    #elif defined(ESP8266)
+    return header().epochUs + micros64();
+    #endif
+}
+
+void record(EventType type, uint8_t arg8, uint16_t arg16) {
+    Header& h = header();
+    if (h.magic != TRACE_MAGIC || !h.enabled) {
+        return;
+    }
+
+    Event event = {static_cast<uint32_t>(nowMicros()), static_cast<uint8_t>(type), arg8, arg16};
+    writeEvent(h.head, event);
+    h.head = static_cast<uint16_t>((h.head + 1) % CAPACITY);
+    if (h.count < CAPACITY) {
+        h.count++;
+    }
+    saveHeader();
+}
+
+void recordWake(uint8_t cause) {
+    record(EventType::WAKE, cause, static_cast<uint16_t>(nowMicros() >> 32));
+}
+
+void recordSleep(bool deep, unsigned long sleepMs) {
+    if (sleepMs > MAX_SLEEP_MS) {
+        sleepMs = MAX_SLEEP_MS;
+    }
+    record(deep ? EventType::SLEEP_DEEP : EventType::SLEEP_LIGHT,
+           static_cast<uint8_t>(sleepMs >> 16), static_cast<uint16_t>(sleepMs));
+
+    #if defined(ESP8266)
+    // micros() restarts at the wake; carry the trace clock over the sleep
+    if (deep && isEnabled()) {
+        header().epochUs = nowMicros() + static_cast<uint64_t>(sleepMs) * 1000;
+        saveHeader();
+    }
+    #endif
+}
+
+size_t size() {
+    const Header& h = header();
+    return h.magic == TRACE_MAGIC ? h.count : 0;
+}
+
+size_t capacity() {
+    return CAPACITY;
+}
+
+bool read(size_t index, Event& event) {
+    const Header& h = header();
+    if (index >= size()) {
+        return false;
+    }
+    readEvent((h.head + CAPACITY - h.count + index) % CAPACITY, event);
+    return true;
+}
+
+void clear() {
+    begin();
+    reset(header(), isEnabled());
+}
+
+size_t serialize(uint8_t* buffer, size_t size) {
+    if (size < DUMP_HEADER_SIZE) {
+        return 0;
+    }
+
+    // Keep the newest events when the buffer cannot take them all
+    size_t count = std::min(TraceRecorder::size(), (size - DUMP_HEADER_SIZE) / sizeof(Event));
+    size_t first = TraceRecorder::size() - count;
+    encodeHeader(count, buffer);
+    for (size_t i = 0; i < count; ++i) {
+        Event event = {};
+        read(first + i, event);
+        encodeEvent(event, buffer + DUMP_HEADER_SIZE + i * sizeof(Event));
+    }
+    return DUMP_HEADER_SIZE + count * sizeof(Event);
+}
+
+void dump(Print& out) {
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    constexpr size_t LINE_BYTES = 32;
+
+    size_t count = size();
+    out.print("TRACE BEGIN ");
+    out.println(static_cast<unsigned long>(DUMP_HEADER_SIZE + count * sizeof(Event)));
+
+    // Encode an event at a time so the dump needs no buffer for the whole ring
+    char line[2 * LINE_BYTES + 1];
+    size_t column = 0;
+    auto emit = [&](const uint8_t* bytes, size_t length) {
+        for (size_t i = 0; i < length; ++i) {
+            line[2 * column] = HEX_DIGITS[bytes[i] >> 4];
+            line[2 * column + 1] = HEX_DIGITS[bytes[i] & 0x0F];
+            if (++column == LINE_BYTES) {
+                line[2 * column] = '\0';
+                out.println(line);
+                column = 0;
+            }
+        }
+    };
+
+    uint8_t bytes[DUMP_HEADER_SIZE];
+    encodeHeader(count, bytes);
+    emit(bytes, DUMP_HEADER_SIZE);
+    for (size_t i = 0; i < count; ++i) {
+        Event event = {};
+        read(i, event);
+        encodeEvent(event, bytes);
+        emit(bytes, sizeof(Event));
+    }
+    if (column > 0) {
+        line[2 * column] = '\0';
+        out.println(line);
+    }
+    out.println("TRACE END");
+}
+
+} // namespace TraceRecorder
@@ -0,0 +1,140 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <Arduino.h>
+
+#ifndef ESP_LOW_POWER_SENSOR_TRACE_EVENTS
+#define ESP_LOW_POWER_SENSOR_TRACE_EVENTS 256  ///< Ring capacity on ESP32; ESP8266 uses what fits its RTC memory
+#endif
+
+/**
+ * @namespace TraceRecorder
+ * @brief Fixed-size ring of scheduler events kept in RTC memory across deep sleep.
+ *
+ * Events carry a microsecond timestamp that keeps counting through deep sleep
+ * (the RTC timer on ESP32; on ESP8266 the requested sleep is added to micros()),
+ * so one dump covers many wakes. When the ring is full the oldest events are
+ * overwritten. Recording is off until setEnabled(true) and then costs one
+ * 8-byte write into RTC memory per event.
+ *
+ * dump() prints the ring as hex over serial; serialize() gives the same bytes
+ * for sending over the uplink. extras/trace/trace_to_chrome.py turns either
+ * into a Chrome trace timeline.
+ */
+namespace TraceRecorder {
+    /** @brief Kinds of recorded events. */
+    enum class EventType : uint8_t {
+        WAKE = 1,         ///< Boot or return from sleep; arg8 is the wake cause
+        DISPATCH_BEGIN,   ///< Sensor callbacks starting; arg16 is the sensor id
+        DISPATCH_END,     ///< Sensor callbacks finished; arg16 is the sensor id
+        QUEUE_OVERFLOW,   ///< Interrupt queue full; arg16 is the sensor id left on the heap
+        WIFI,             ///< WiFi state change; arg8 is a WifiState
+        SLEEP_LIGHT,      ///< Light sleep requested; arg8:arg16 is the time in milliseconds
+        SLEEP_DEEP        ///< Deep sleep requested; arg8:arg16 is the time in milliseconds
+    };
+
+    /** @brief WiFi states recorded with EventType::WIFI. */
+    enum class WifiState : uint8_t {
+        OFF,
+        CONNECTING,
+        CONNECTED,
+        FAILED
+    };
+
+    /**
+     * @brief One recorded event.
+     *
+     * Only the low 32 bits of the timestamp are stored; WAKE events carry bits
+     * 32-47 in arg16, and the decoder counts wraps between wakes.
+     */
+    struct Event {
+        uint32_t time;    ///< Microseconds, low 32 bits
+        uint8_t type;     ///< EventType
+        uint8_t arg8;
+        uint16_t arg16;
+    };
+
+    /**
+     * @brief Validates the ring; after power-on or any reset other than a deep-sleep wake, clears it.
+     */
+    void begin();
+
+    /**
+     * @brief Enables or disables recording. The setting is kept across deep sleep.
+     * @param enabled Whether to record events.
+     */
+    void setEnabled(bool enabled);
+
+    /**
+     * @brief Checks if events are being recorded.
+     * @return True if recording is enabled, false otherwise.
+     */
+    bool isEnabled();
+
+    /**
+     * @brief Records an event, if recording is enabled.
+     * @param type The kind of event.
+     * @param arg8 Small argument, see EventType.
+     * @param arg16 Larger argument, see EventType.
+     */
+    void record(EventType type, uint8_t arg8 = 0, uint16_t arg16 = 0);
+
+    /**
+     * @brief Records a wake with its cause and the high bits of the timestamp.
+     * @param cause esp_sleep_wakeup_cause_t on ESP32, the reset reason on ESP8266.
+     */
+    void recordWake(uint8_t cause);
+
+    /**
+     * @brief Records a requested sleep. Times above 2^24 - 1 ms are saturated.
+     * @param deep Whether this is deep sleep.
+     * @param sleepMs Requested sleep time in milliseconds.
+     */
+    void recordSleep(bool deep, unsigned long sleepMs);
+
+    /**
+     * @brief Gets the number of events in the ring.
+     * @return The number of events, at most capacity().
+     */
+    size_t size();
+
+    /**
+     * @brief Gets the number of events the ring can hold.
+     * @return The ring capacity.
+     */
+    size_t capacity();
+
+    /**
+     * @brief Reads an event, oldest first.
+     * @param index Position from the oldest event.
+     * @param[out] event The event.
+     * @return True if index is within the ring, false otherwise.
+     */
+    bool read(size_t index, Event& event);
+
+    /** @brief Removes all events. */
+    void clear();
+
+    /**
+     * @brief Copies the ring into a buffer: an 8-byte header (magic "LPTR",
+     * format version, platform, event count) followed by the events, oldest first.
+     * @param buffer Destination.
+     * @param size Size of the buffer in bytes.
+     * @return Number of bytes written; the oldest events that do not fit are left out.
+     */
+    size_t serialize(uint8_t* buffer, size_t size);
+
+    /**
+     * @brief Prints the ring in hex between "TRACE BEGIN" and "TRACE END" lines.
+     * @param out Where to print, e.g. Serial.
+     */
+    void dump(Print& out);
+
+    /**
+     * @brief Gets the trace clock.
+     * @return Microseconds, continuing across deep sleep.
+     */
+    uint64_t nowMicros();
+}
+
+#endif // TRACE_RECORDER_H
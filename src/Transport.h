@@ -0,0 +1,52 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @class Transport
+ * @brief A connectionless radio link to a gateway, used instead of WiFi association.
+ *
+ * A transport moves whole frames and knows nothing of acknowledgements,
+ * retries or batching; ReportLink adds those on top. EspNowTransport sends
+ * ESP-NOW frames to a mains-powered gateway; LoopbackTransport answers in
+ * memory so the protocol can be tested on a host without radios.
+ */
+class Transport {
+public:
+    virtual ~Transport() {}
+
+    /**
+     * @brief Powers up the radio and gets ready to send.
+     * @return True if the transport is ready, false otherwise.
+     */
+    virtual bool begin() = 0;
+
+    /** @brief Powers down the radio. */
+    virtual void end() = 0;
+
+    /**
+     * @brief Gets the largest frame the transport carries.
+     * @return The frame size limit in bytes.
+     */
+    virtual size_t maxFrameSize() const = 0;
+
+    /**
+     * @brief Hands a frame to the radio. Delivery is not confirmed.
+     * @param frame The frame.
+     * @param length The frame length in bytes.
+     * @return True if the frame was sent, false if the radio refused it.
+     */
+    virtual bool send(const uint8_t* frame, size_t length) = 0;
+
+    /**
+     * @brief Takes the oldest received frame, without waiting.
+     * @param buffer Where to copy the frame.
+     * @param size Size of the buffer in bytes.
+     * @return The frame length, or zero if no frame has arrived.
+     */
+    virtual size_t receive(uint8_t* buffer, size_t size) = 0;
+};
+
+#endif // TRANSPORT_H
@@ -0,0 +1,71 @@
+#include "UplinkSchedule.h"
+
+UplinkSchedule::Config UplinkSchedule::defaults() {
+    Config config = {
+        0,      // slotCount: offsets over the whole interval
+        2,      // jitterPercent
+        10000,  // attemptTimeoutMs: one 10 s wait, as before staggering
+        1,      // maxAttempts
+        500,    // backoffBaseMs
+        4000    // backoffMaxMs
+    };
+    return config;
+}
+
+uint32_t UplinkSchedule::mix(uint32_t id) {
+    // MurmurHash3 finalizer
+    id ^= id >> 16;
+    id *= 0x85EBCA6Bu;
+    id ^= id >> 13;
+    id *= 0xC2B2AE35u;
+    id ^= id >> 16;
+    return id;
+}
+
+UplinkSchedule::UplinkSchedule() : UplinkSchedule(defaults()) {
+}
+
+UplinkSchedule::UplinkSchedule(const Config& config)
+    : _config(config),
+      _nodeId(0),
+      _random(1) {
+}
+
+void UplinkSchedule::seed(uint32_t seed) {
+    // xorshift32 must not start from zero
+    _random = mix(seed ^ _nodeId) | 1;
+}
+
+unsigned long UplinkSchedule::slotOffset(unsigned long interval) const {
+    if (interval == 0) {
+        return 0;
+    }
+    if (_config.slotCount == 0) {
+        return mix(_nodeId) % interval;
+    }
+    uint32_t slot = _nodeId % _config.slotCount;
+    return static_cast<unsigned long>(static_cast<uint64_t>(interval) * slot / _config.slotCount);
+}
+
+unsigned long UplinkSchedule::cycleJitter(unsigned long interval) {
+    unsigned long limit = static_cast<unsigned long>(static_cast<uint64_t>(interval) * _config.jitterPercent / 100);
+    return limit ? nextRandom() % (limit + 1) : 0;
+}
+
+unsigned long UplinkSchedule::backoffDelay(uint8_t attempt) {
+    unsigned long limit = _config.backoffBaseMs;
+    for (uint8_t i = 0; i < attempt && limit < _config.backoffMaxMs; ++i) {
+        limit *= 2;
+    }
+    if (limit > _config.backoffMaxMs) {
+        limit = _config.backoffMaxMs;
+    }
+    return limit ? nextRandom() % (limit + 1) : 0;
+}
+
+uint32_t UplinkSchedule::nextRandom() {
+    _random ^= _random << 13;
+    _random ^= _random >> 17;
+    _random ^= _random << 5;
+    return _random;
+}
@@ -0,0 +1,102 @@
+#ifndef UPLINK_SCHEDULE_H
+#define UPLINK_SCHEDULE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @class UplinkSchedule
+ * @brief Spreads the uplinks of many nodes sharing one access point.
+ *
+ * Nodes that power up together and share a single interval would otherwise
+ * connect at the same instant on every cycle, and association slows down for
+ * all of them. Each node gets a deterministic transmit slot within the
+ * interval from its node id, and each cycle starts a small random jitter
+ * after the slot so nodes whose clocks drift into the same slot do not
+ * connect at the same instant. The jitter is drawn afresh around the slot
+ * every cycle rather than added to the previous one, so the slots stay apart. With more than one connection attempt configured, failed attempts
+ * back off for a random time up to an exponentially growing limit, with the
+ * radio off, instead of holding the radio on for one long wait.
+ *
+ * The class holds no hardware state; ESPLowPowerSensor supplies the node id
+ * (from the MAC address unless one is configured) and a hardware random seed.
+ */
+class UplinkSchedule {
+public:
+    /**
+     * @struct Config
+     * @brief Slot, jitter and connection backoff settings.
+     */
+    struct Config {
+        uint16_t slotCount;              ///< Slots per interval; 0 spreads offsets over the whole interval
+        uint8_t jitterPercent;           ///< Each cycle starts up to this share of the interval after the slot
+        unsigned long attemptTimeoutMs;  ///< Longest wait for one connection attempt
+        uint8_t maxAttempts;             ///< Connection attempts before giving up
+        unsigned long backoffBaseMs;     ///< Backoff limit after the first failed attempt
+        unsigned long backoffMaxMs;      ///< Cap on the backoff limit
+    };
+
+    /**
+     * @brief Gets the default settings: offsets over the whole interval, 2%
+     * jitter and a single 10 s connection attempt. With maxAttempts raised,
+     * backoff limits start at 0.5 s and double up to 4 s.
+     */
+    static Config defaults();
+
+    /**
+     * @brief Mixes an id so that nearby ids (e.g. consecutive MAC addresses) land in distant slots.
+     * @param id The id to mix.
+     * @return The mixed id.
+     */
+    static uint32_t mix(uint32_t id);
+
+    UplinkSchedule();
+    explicit UplinkSchedule(const Config& config);
+
+    /**
+     * @brief Sets the node id. With slotCount set, nodes with ids 0 to slotCount - 1 get distinct slots.
+     * @param id The node id.
+     */
+    void setNodeId(uint32_t id) { _nodeId = id; }
+
+    uint32_t nodeId() const { return _nodeId; }
+
+    /**
+     * @brief Seeds the random jitter and backoff.
+     * @param seed Seed, e.g. from the hardware random number generator.
+     */
+    void seed(uint32_t seed);
+
+    /**
+     * @brief Gets this node's transmit slot.
+     * @param interval The interval the slots divide, in milliseconds.
+     * @return Offset of the slot from the start of the interval, in milliseconds.
+     */
+    unsigned long slotOffset(unsigned long interval) const;
+
+    /**
+     * @brief Draws how long after the slot one cycle starts.
+     * @param interval The cycle interval in milliseconds.
+     * @return A random time from zero to jitterPercent of the interval, in milliseconds.
+     */
+    unsigned long cycleJitter(unsigned long interval);
+
+    /**
+     * @brief Draws the wait after a failed connection attempt ("full jitter" backoff).
+     * @param attempt Zero for the first failed attempt, one for the second, and so on.
+     * @return A random time up to min(backoffMaxMs, backoffBaseMs * 2^attempt), in milliseconds.
+     */
+    unsigned long backoffDelay(uint8_t attempt);
+
+    void setConfig(const Config& config) { _config = config; }
+    const Config& config() const { return _config; }
+
+private:
+    Config _config;
+    uint32_t _nodeId;
+    uint32_t _random;
+
+    uint32_t nextRandom();
+};
+
+#endif // UPLINK_SCHEDULE_H
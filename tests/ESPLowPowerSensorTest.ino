@@ -1,28 +1,6 @@
 #include <AUnit.h>
 #include <ESPLowPowerSensor.h>
-
-// Mock functions for WiFi and sleep operations
-unsigned long mockSleepDuration = 0;
-bool mockWifiStatus = false;
-
-void mockGoToSleep(unsigned long sleepTime) {
-    mockSleepDuration = sleepTime;
-}
-
-bool mockWifiOff() {
-    mockWifiStatus = false;
-    return true;
-}
-
-bool mockWifiOn() {
-    mockWifiStatus = true;
-    return true;
-}
-
-// Override the original functions with mock functions
-#define goToSleep(x) mockGoToSleep(x)
-#define wifiOff() mockWifiOff()
-#define wifiOn() mockWifiOn()
+#include <LoopbackTransport.h>
 
 void setup() {
   Serial.begin(115200);
@@ -42,14 +20,14 @@ test(constructor) {
 
 test(init_per_sensor_mode) {
   ESPLowPowerSensor sensor;
-  assertTrue(sensor.init(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
   // After initialization, adding a sensor with interval should succeed
-  assertTrue(sensor.addSensor([](){}, nullptr, 1000));
+  assertTrue(sensor.addSensor([](){}, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 1000));
 }
 
 test(init_single_interval_mode) {
   ESPLowPowerSensor sensor;
-  assertTrue(sensor.init(ESPLowPowerSensor::Mode::SINGLE_INTERVAL, true, ESPLowPowerSensor::LowPowerMode::DEEP_SLEEP));
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::SINGLE_INTERVAL, true, ESPLowPowerSensor::LowPowerMode::DEEP_SLEEP));
   // After initialization in SINGLE_INTERVAL mode, adding a sensor without interval should succeed
   assertTrue(sensor.addSensor([](){}));
 }
@@ -57,43 +35,43 @@ test(init_single_interval_mode) {
 test(init_invalid_mode) {
   ESPLowPowerSensor sensor;
   // Cast an invalid value to Mode to test error handling
-  assertFalse(sensor.init(static_cast<ESPLowPowerSensor::Mode>(99), false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+  assertFalse(sensor.initialize(static_cast<ESPLowPowerSensor::Mode>(99), false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
 }
 
 test(addSensor_per_sensor_mode) {
   ESPLowPowerSensor sensor;
-  assertTrue(sensor.init(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
   
   // Valid case: add sensor with wake function and interval
-  assertTrue(sensor.addSensor([](){}, nullptr, 1000));
+  assertTrue(sensor.addSensor([](){}, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 1000));
   
   // Invalid case: add sensor without interval in PER_SENSOR mode
   assertFalse(sensor.addSensor([](){}));
   
   // Invalid case: add sensor with zero interval in PER_SENSOR mode
-  assertFalse(sensor.addSensor([](){}, nullptr, 0));
+  assertFalse(sensor.addSensor([](){}, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 0));
 }
 
 test(addSensor_single_interval_mode) {
   ESPLowPowerSensor sensor;
-  assertTrue(sensor.init(ESPLowPowerSensor::Mode::SINGLE_INTERVAL, false, ESPLowPowerSensor::LowPowerMode::DEEP_SLEEP));
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::SINGLE_INTERVAL, false, ESPLowPowerSensor::LowPowerMode::DEEP_SLEEP));
   
   // Valid case: add sensor without interval
   assertTrue(sensor.addSensor([](){}));
   
   // Valid case: add sensor with interval (should set single interval)
-  assertTrue(sensor.addSensor([](){}, nullptr, 2000));
+  assertTrue(sensor.addSensor([](){}, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 2000));
   
   // Invalid case: add sensor with different interval
-  assertFalse(sensor.addSensor([](){}, nullptr, 3000));
+  assertFalse(sensor.addSensor([](){}, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 3000));
 }
 
 test(addSensor_invalid_input) {
   ESPLowPowerSensor sensor;
-  assertTrue(sensor.init(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
   
   // Invalid case: add sensor without wake function
-  assertFalse(sensor.addSensor(nullptr, [](){}, 1000));
+  assertFalse(sensor.addSensor(nullptr, [](){}, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 1000));
 }
 
 // Helper function to simulate passage of time
@@ -106,13 +84,13 @@ void simulateDelay(ESPLowPowerSensor& sensor, unsigned long ms) {
 
 test(run_per_sensor_mode) {
   ESPLowPowerSensor sensor;
-  assertTrue(sensor.init(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
   
   int sensor1Count = 0;
   int sensor2Count = 0;
   
-  assertTrue(sensor.addSensor([&sensor1Count](){ sensor1Count++; }, nullptr, 100));
-  assertTrue(sensor.addSensor([&sensor2Count](){ sensor2Count++; }, nullptr, 200));
+  assertTrue(sensor.addSensor([&sensor1Count](){ sensor1Count++; }, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 100));
+  assertTrue(sensor.addSensor([&sensor2Count](){ sensor2Count++; }, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 200));
   
   simulateDelay(sensor, 250);
   
@@ -122,7 +100,7 @@ test(run_per_sensor_mode) {
 
 test(run_single_interval_mode) {
   ESPLowPowerSensor sensor;
-  assertTrue(sensor.init(ESPLowPowerSensor::Mode::SINGLE_INTERVAL, false, ESPLowPowerSensor::LowPowerMode::DEEP_SLEEP));
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::SINGLE_INTERVAL, false, ESPLowPowerSensor::LowPowerMode::DEEP_SLEEP));
   
   int sensor1Count = 0;
   int sensor2Count = 0;
@@ -137,38 +115,35 @@ test(run_single_interval_mode) {
   assertEqual(2, sensor2Count);
 }
 
-test(goToSleep) {
+test(timeUntilNextSensor) {
   ESPLowPowerSensor sensor;
-  sensor.init(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP);
-  
-  mockSleepDuration = 0;
-  sensor.goToSleep(1000);
-  assertEqual(1000UL, mockSleepDuration);
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+  assertTrue(sensor.addSensor([](){}, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 1000));
+  sensor.run();
+
+  unsigned long remaining = 0;
+  assertTrue(sensor.getTimeUntilNextSensor(remaining));
+  assertTrue(remaining > 0);
+  assertTrue(remaining <= 1000UL);
 }
 
-test(wifiOperations) {
+test(wifiNotRequired) {
   ESPLowPowerSensor sensor;
-  sensor.init(ESPLowPowerSensor::Mode::PER_SENSOR, true, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP);
-  
-  mockWifiStatus = true;
-  assertTrue(sensor.wifiOff());
-  assertFalse(mockWifiStatus);
-  
-  assertTrue(sensor.wifiOn());
-  assertTrue(mockWifiStatus);
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+  assertTrue(sensor.ensureWifi());
 }
 
 // More test cases will be added in subsequent tasks
 
 test(runPerSensorMode) {
   ESPLowPowerSensor sensor;
-  assertTrue(sensor.init(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
   
   int sensor1Count = 0;
   int sensor2Count = 0;
   
-  assertTrue(sensor.addSensor([&sensor1Count](){ sensor1Count++; }, nullptr, 100));
-  assertTrue(sensor.addSensor([&sensor2Count](){ sensor2Count++; }, nullptr, 200));
+  assertTrue(sensor.addSensor([&sensor1Count](){ sensor1Count++; }, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 100));
+  assertTrue(sensor.addSensor([&sensor2Count](){ sensor2Count++; }, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 200));
   
   // Simulate running for 250ms
   for (int i = 0; i < 25; i++) {
@@ -191,7 +166,7 @@ test(runPerSensorMode) {
 
 test(runSingleIntervalMode) {
   ESPLowPowerSensor sensor;
-  assertTrue(sensor.init(ESPLowPowerSensor::Mode::SINGLE_INTERVAL, false, ESPLowPowerSensor::LowPowerMode::DEEP_SLEEP));
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::SINGLE_INTERVAL, false, ESPLowPowerSensor::LowPowerMode::DEEP_SLEEP));
   
   int sensor1Count = 0;
   int sensor2Count = 0;
@@ -223,23 +198,23 @@ test(runSingleIntervalMode) {
 
 test(addManySensors) {
   ESPLowPowerSensor sensor;
-  assertTrue(sensor.init(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
   
-  const int maxSensors = 100; // Adjust this value based on the expected maximum number of sensors
+  const int maxSensors = MAX_SENSORS;
   for (int i = 0; i < maxSensors; i++) {
-    assertTrue(sensor.addSensor([](){ /* Do nothing */ }, nullptr, (i + 1) * 100));
+    assertTrue(sensor.addSensor([](){ /* Do nothing */ }, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, (i + 1) * 100));
   }
   
   // Try to add one more sensor, which should fail
-  assertFalse(sensor.addSensor([](){ /* Do nothing */ }, nullptr, (maxSensors + 1) * 100));
+  assertFalse(sensor.addSensor([](){ /* Do nothing */ }, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, (maxSensors + 1) * 100));
 }
 
 test(veryShortInterval) {
   ESPLowPowerSensor sensor;
-  assertTrue(sensor.init(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
   
   int sensorCount = 0;
-  assertTrue(sensor.addSensor([&sensorCount](){ sensorCount++; }, nullptr, 1)); // 1ms interval
+  assertTrue(sensor.addSensor([&sensorCount](){ sensorCount++; }, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 1)); // 1ms interval
   
   simulateDelay(sensor, 10);
   
@@ -250,10 +225,10 @@ test(veryShortInterval) {
 
 test(veryLongInterval) {
   ESPLowPowerSensor sensor;
-  assertTrue(sensor.init(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
   
   int sensorCount = 0;
-  assertTrue(sensor.addSensor([&sensorCount](){ sensorCount++; }, nullptr, 3600000)); // 1 hour interval
+  assertTrue(sensor.addSensor([&sensorCount](){ sensorCount++; }, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 3600000)); // 1 hour interval
   
   simulateDelay(sensor, 10000); // Run for 10 seconds
   
@@ -262,12 +237,12 @@ test(veryLongInterval) {
 
 test(mixedIntervals) {
   ESPLowPowerSensor sensor;
-  assertTrue(sensor.init(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
   
   int shortCount = 0, mediumCount = 0, longCount = 0;
-  assertTrue(sensor.addSensor([&shortCount](){ shortCount++; }, nullptr, 100));    // 100ms interval
-  assertTrue(sensor.addSensor([&mediumCount](){ mediumCount++; }, nullptr, 250));  // 250ms interval
-  assertTrue(sensor.addSensor([&longCount](){ longCount++; }, nullptr, 500));      // 500ms interval
+  assertTrue(sensor.addSensor([&shortCount](){ shortCount++; }, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 100));    // 100ms interval
+  assertTrue(sensor.addSensor([&mediumCount](){ mediumCount++; }, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 250));  // 250ms interval
+  assertTrue(sensor.addSensor([&longCount](){ longCount++; }, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 500));      // 500ms interval
   
   simulateDelay(sensor, 1000);
   
@@ -280,7 +255,7 @@ test(mixedIntervals) {
 
 test(digitalTrigger) {
   ESPLowPowerSensor sensor;
-  assertTrue(sensor.init(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
   
   int triggerCount = 0;
   const int DIGITAL_PIN = 2;
@@ -301,7 +276,7 @@ test(digitalTrigger) {
 
 test(analogTrigger) {
   ESPLowPowerSensor sensor;
-  assertTrue(sensor.init(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
   
   int triggerCount = 0;
   const int ANALOG_PIN = A0;
@@ -322,7 +297,7 @@ test(analogTrigger) {
 
 test(mixedTriggerModes) {
   ESPLowPowerSensor sensor;
-  assertTrue(sensor.init(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
   
   int timeIntervalCount = 0, digitalCount = 0, analogCount = 0;
   const int DIGITAL_PIN = 2;
@@ -349,14 +324,14 @@ test(mixedTriggerModes) {
 
 test(initialization) {
   ESPLowPowerSensor sensor;
-  assertTrue(sensor.init(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
   assertEqual(ESPLowPowerSensor::Mode::PER_SENSOR, sensor.getMode());
   assertEqual(ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP, sensor.getLowPowerMode());
 }
 
 test(addSensor) {
   ESPLowPowerSensor sensor;
-  assertTrue(sensor.init(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
   
   // Test adding a sensor with TIME_INTERVAL trigger mode
   assertTrue(sensor.addSensor([](){}, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 1000));
@@ -374,9 +349,9 @@ test(addSensor) {
   assertFalse(sensor.addSensor([](){}, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 1000));
 }
 
-test(runPerSensorMode) {
+test(runPerSensorMode_with_trigger_mode) {
   ESPLowPowerSensor sensor;
-  assertTrue(sensor.init(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
   
   int count1 = 0, count2 = 0;
   assertTrue(sensor.addSensor([&count1](){ count1++; }, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 100));
@@ -388,9 +363,9 @@ test(runPerSensorMode) {
   assertEqual(1, count2);
 }
 
-test(runSingleIntervalMode) {
+test(runSingleIntervalMode_light_sleep) {
   ESPLowPowerSensor sensor;
-  assertTrue(sensor.init(ESPLowPowerSensor::Mode::SINGLE_INTERVAL, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::SINGLE_INTERVAL, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
   
   int count1 = 0, count2 = 0;
   assertTrue(sensor.addSensor([&count1](){ count1++; }, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 100));
@@ -402,11 +377,658 @@ test(runSingleIntervalMode) {
   assertEqual(2, count2);
 }
 
-// Add a helper function to simulate delay while allowing the sensor to run
-void simulateDelay(ESPLowPowerSensor& sensor, unsigned long ms) {
+// Sensor registry
+
+test(sensorRegistry_heap_order) {
+  SensorRegistry registry(8);
+  SensorRegistry::SensorId late = registry.add(100, 300, false);
+  SensorRegistry::SensorId early = registry.add(100, 100, false);
+  SensorRegistry::SensorId middle = registry.add(100, 200, false);
+
+  assertTrue(registry.peekDue(99) == SensorRegistry::INVALID_ID);
+  assertTrue(registry.peekDue(100) == early);
+  registry.reschedule(early, 400);
+  assertTrue(registry.peekDue(250) == middle);
+  registry.reschedule(middle, 500);
+  assertTrue(registry.peekDue(300) == late);
+
+}
+
+test(sensorRegistry_orders_across_rollover) {
+  SensorRegistry registry(4);
+  const unsigned long beforeWrap = static_cast<unsigned long>(-16);
+  SensorRegistry::SensorId afterWrapId = registry.add(100, 16, false);
+  SensorRegistry::SensorId beforeWrapId = registry.add(100, beforeWrap, false);
+
+  unsigned long remaining = 0;
+  assertTrue(registry.timeUntilNextDue(beforeWrap - 16, remaining));
+  assertEqual(16UL, remaining);
+  assertTrue(registry.peekDue(0) == beforeWrapId);
+  registry.reschedule(beforeWrapId, 116);
+  assertTrue(registry.peekDue(16) == afterWrapId);
+}
+
+test(sensorRegistry_reuses_removed_slots) {
+  SensorRegistry registry(2);
+  SensorRegistry::SensorId first = registry.add(100, 100, false);
+  SensorRegistry::SensorId polled = registry.add(0, 0, true);
+  assertTrue(registry.add(100, 100, false) == SensorRegistry::INVALID_ID);
+  assertEqual((size_t) 1, registry.polled().size());
+
+  assertTrue(registry.remove(polled));
+  assertEqual((size_t) 0, registry.polled().size());
+  SensorRegistry::SensorId reused = registry.add(100, 50, false);
+  assertTrue(reused == polled);
+  assertEqual((size_t) 2, registry.slotCount());
+  assertTrue(registry.peekDue(50) == reused);
+
+  assertTrue(registry.remove(first));
+  assertFalse(registry.remove(first));
+  assertEqual((size_t) 1, registry.size());
+}
+
+test(sensorRegistry_polled_membership) {
+  SensorRegistry registry(4);
+  SensorRegistry::SensorId a = registry.add(0, 0, true);
+  SensorRegistry::SensorId b = registry.add(0, 0, true);
+  SensorRegistry::SensorId c = registry.add(0, 0, true);
+
+  // Taking one out moves the last into its place
+  assertTrue(registry.setEnabled(a, false));
+  assertEqual((size_t) 2, registry.polled().size());
+  assertTrue(registry.polled()[0] == c);
+  assertTrue(registry.polled()[1] == b);
+  assertTrue(registry.setEnabled(a, false));
+  assertEqual((size_t) 2, registry.polled().size());
+
+  assertTrue(registry.remove(c));
+  assertTrue(registry.setEnabled(a, true));
+  assertEqual((size_t) 2, registry.polled().size());
+  assertTrue(registry.polled()[0] == b);
+  assertTrue(registry.polled()[1] == a);
+}
+
+test(sensorRegistry_rejects_invalid_ids) {
+  SensorRegistry registry(4);
+  assertFalse(registry.contains(SensorRegistry::INVALID_ID));
+  assertFalse(registry.remove(SensorRegistry::INVALID_ID));
+  assertFalse(registry.updateInterval(SensorRegistry::INVALID_ID, 100));
+  assertFalse(registry.setEnabled(3, false));
+  assertFalse(registry.isEnabled(3));
+  registry.reschedule(SensorRegistry::INVALID_ID, 0);
+  assertEqual((size_t) 0, registry.size());
+}
+
+test(sensor_callback_replaces_itself) {
+  static ESPLowPowerSensor* manager;
+  static ESPLowPowerSensor::SensorId oldId, newId;
+  static int oldRuns, newRuns, keptRuns;
+  oldRuns = newRuns = keptRuns = 0;
+  ESPLowPowerSensor sensor;
+  manager = &sensor;
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+  sensor.clearPersistedConfig();
+
+  // The callback removes its sensor and adds one that takes over the slot
+  assertTrue(sensor.addSensor([]() {
+    oldRuns++;
+    manager->removeSensor(oldId);
+    manager->addSensor([]() { newRuns++; }, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 100, 0, &newId);
+  }, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 100, 0, &oldId));
+  assertTrue(sensor.addSensor([]() { keptRuns++; }, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 100));
+
+  delay(100);
+  sensor.run();
+  assertTrue(newId == oldId);
+  delay(100);
+  sensor.run();
+  assertEqual(1, oldRuns);
+  assertEqual(1, newRuns);
+  assertEqual(2, keptRuns);
+  sensor.clearPersistedConfig();
+}
+
+// Runtime reconfiguration
+
+test(setMode_ignores_pin_triggered_sensors) {
+  ESPLowPowerSensor sensor;
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+
+  // The trigger values of the DIGITAL and ANALOG_TRIGGER sensors are not intervals
+  assertTrue(sensor.addSensor([](){}, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 1000));
+  assertTrue(sensor.addSensor([](){}, nullptr, ESPLowPowerSensor::TriggerMode::DIGITAL, LOW, 2));
+  assertTrue(sensor.addSensor([](){}, nullptr, ESPLowPowerSensor::TriggerMode::ANALOG_TRIGGER, 500, A0));
+
+  assertTrue(sensor.setMode(ESPLowPowerSensor::Mode::SINGLE_INTERVAL));
+  assertEqual(1000UL, sensor.getSingleInterval());
+  assertTrue(sensor.setMode(ESPLowPowerSensor::Mode::PER_SENSOR));
+}
+
+test(setMode_rejects_different_intervals) {
+  ESPLowPowerSensor sensor;
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+
+  assertTrue(sensor.addSensor([](){}, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 1000));
+  assertTrue(sensor.addSensor([](){}, nullptr, ESPLowPowerSensor::TriggerMode::ANALOG_TRIGGER, 1000, A0));
+  assertTrue(sensor.addSensor([](){}, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 2000));
+
+  assertFalse(sensor.setMode(ESPLowPowerSensor::Mode::SINGLE_INTERVAL));
+  assertEqual(ESPLowPowerSensor::Mode::PER_SENSOR, sensor.getMode());
+}
+
+test(setSensorEnabled) {
+  ESPLowPowerSensor sensor;
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+
+  int count = 0;
+  ESPLowPowerSensor::SensorId id;
+  assertTrue(sensor.addSensor([&count](){ count++; }, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 100, 0, &id));
+
+  assertTrue(sensor.setSensorEnabled(id, false));
+  assertFalse(sensor.isSensorEnabled(id));
+  simulateDelay(sensor, 250);
+  assertEqual(0, count);
+
+  assertTrue(sensor.setSensorEnabled(id, true));
+  simulateDelay(sensor, 250);
+  assertTrue(count > 0);
+}
+
+test(updateInterval_and_removeSensor) {
+  ESPLowPowerSensor sensor;
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+
+  int count = 0;
+  ESPLowPowerSensor::SensorId timedId, digitalId;
+  assertTrue(sensor.addSensor([&count](){ count++; }, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 3600000, 0, &timedId));
+  assertTrue(sensor.addSensor([](){}, nullptr, ESPLowPowerSensor::TriggerMode::DIGITAL, HIGH, 2, &digitalId));
+
+  // Intervals only apply to TIME_INTERVAL sensors, thresholds only to pin-triggered ones
+  assertFalse(sensor.updateInterval(digitalId, 100));
+  assertFalse(sensor.updateThreshold(timedId, 100));
+  assertFalse(sensor.updateInterval(timedId, 0));
+  assertTrue(sensor.updateThreshold(digitalId, LOW));
+
+  assertTrue(sensor.updateInterval(timedId, 100));
+  simulateDelay(sensor, 250);
+  assertTrue(count > 0);
+
+  assertTrue(sensor.removeSensor(timedId));
+  assertFalse(sensor.removeSensor(timedId));
+  assertEqual((size_t)1, sensor.getSensorCount());
+}
+
+test(applyConfig_is_atomic) {
+  ESPLowPowerSensor sensor;
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+  sensor.clearPersistedConfig();  // Changes kept by earlier tests would be replayed here
+
+  ESPLowPowerSensor::SensorId first, second;
+  assertTrue(sensor.addSensor([](){}, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 1000, 0, &first));
+  assertTrue(sensor.addSensor([](){}, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 1000, 0, &second));
+
+  // The last entry is invalid, so none of the entries may be applied
+  ESPLowPowerSensor::SensorConfig invalid[] = {
+    {first, ESPLowPowerSensor::ConfigAction::DISABLE, 0},
+    {second, ESPLowPowerSensor::ConfigAction::REMOVE, 0},
+    {second, ESPLowPowerSensor::ConfigAction::ENABLE, 0}
+  };
+  assertFalse(sensor.applyConfig(invalid, 3));
+  assertTrue(sensor.isSensorEnabled(first));
+  assertEqual((size_t)2, sensor.getSensorCount());
+
+  ESPLowPowerSensor::SensorConfig valid[] = {
+    {first, ESPLowPowerSensor::ConfigAction::DISABLE, 0},
+    {second, ESPLowPowerSensor::ConfigAction::SET_VALUE, 5000}
+  };
+  assertTrue(sensor.applyConfig(valid, 2));
+  assertFalse(sensor.isSensorEnabled(first));
+
+  unsigned long remaining = 0;
+  assertTrue(sensor.getTimeUntilNextSensor(remaining));
+  assertTrue(remaining <= 5000UL);
+  sensor.clearPersistedConfig();
+}
+
+#if defined(HOST_ARDUINO_H)
+// Needs the host stand-in to fake the deep-sleep reset
+test(persistedConfig_follows_reused_slot) {
+  host::setWakeupCause(ESP_SLEEP_WAKEUP_UNDEFINED);
+  ESPLowPowerSensor sensor;
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+  sensor.clearPersistedConfig();
+
+  ESPLowPowerSensor::SensorId first, second, reused;
+  assertTrue(sensor.addSensor([](){}, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 1000, 0, &first));
+  assertTrue(sensor.addSensor([](){}, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 1000, 0, &second));
+  assertTrue(sensor.removeSensor(second));
+  assertTrue(sensor.addSensor([](){}, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 1000, 0, &reused));
+  assertTrue(reused == second);
+  assertTrue(sensor.setSensorEnabled(reused, false));
+
+  // After the deep-sleep reset the sketch adds its sensors again and the
+  // change to the reused slot is replayed, not the earlier removal
+  host::setWakeupCause(ESP_SLEEP_WAKEUP_TIMER);
+  ESPLowPowerSensor rebooted;
+  assertTrue(rebooted.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+  assertTrue(rebooted.addSensor([](){}, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 1000));
+  assertTrue(rebooted.addSensor([](){}, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 1000));
+  assertTrue(rebooted.applyConfig(nullptr, 0));
+  assertEqual((size_t) 2, rebooted.getSensorCount());
+  assertTrue(rebooted.isSensorEnabled(first));
+  assertFalse(rebooted.isSensorEnabled(reused));
+
+  rebooted.clearPersistedConfig();
+  host::setWakeupCause(ESP_SLEEP_WAKEUP_UNDEFINED);
+}
+#endif
+
+// Battery policy
+
+test(batteryPolicy_tiers_with_hysteresis) {
+  BatteryPolicy policy(BatteryPolicy::liIonDefaults());
+
+  assertTrue(policy.update(4000) == BatteryPolicy::Tier::NORMAL);
+  assertTrue(policy.update(3550) == BatteryPolicy::Tier::STRETCH);
+  assertTrue(policy.update(3200) == BatteryPolicy::Tier::HIBERNATE);
+
+  // Recovering past a threshold by less than the hysteresis keeps the tier
+  assertTrue(policy.update(3320) == BatteryPolicy::Tier::HIBERNATE);
+  assertTrue(policy.update(3360) == BatteryPolicy::Tier::CONSERVE);
+  assertTrue(policy.update(4000) == BatteryPolicy::Tier::NORMAL);
+}
+
+test(batteryPolicy_batches_uplinks_and_stretches_intervals) {
+  BatteryPolicy policy(BatteryPolicy::liIonDefaults());
+  policy.update(3400);  // CONSERVE: x4 intervals, uplink every 6th wake
+  assertEqual(4000UL, policy.scaleInterval(1000));
+
+  int uplinks = 0;
+  for (int i = 0; i < 12; i++) {
+    policy.onWake();
+    if (policy.uplinkDue()) {
+      uplinks++;
+    }
+  }
+  assertEqual(2, uplinks);
+}
+
+#if defined(HOST_ARDUINO_H)
+// Needs the host stand-in to set the supply voltage
+test(updateInterval_keeps_scaled_last_execution) {
+  host::setPin(34, 1700);  // 3.4 V behind the divider: CONSERVE, x4 intervals
+  ESPLowPowerSensor sensor;
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+  sensor.clearPersistedConfig();
+  sensor.enableBatteryPolicy(34);
+
+  int count = 0;
+  ESPLowPowerSensor::SensorId id;
+  assertTrue(sensor.addSensor([&count](){ count++; }, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 1000, 0, &id));
+  sensor.run();
+  assertEqual(1, count);
+  assertTrue(sensor.getBatteryTier() == BatteryPolicy::Tier::CONSERVE);
+
+  // The new interval is scaled too and counts from the last execution
+  assertTrue(sensor.updateInterval(id, 2000));
+  delay(7000);
+  sensor.run();
+  assertEqual(1, count);
+  delay(1000);
+  sensor.run();
+  assertEqual(2, count);
+
+  sensor.clearPersistedConfig();
+  host::setPin(34, 0);
+}
+#endif
+
+// Fast wake
+
+#if defined(HOST_ARDUINO_H)
+// Needs the host stand-in to fake deep sleep and the wake cause
+test(sleepIfIdle_sleeps_out_early_timer_wake) {
+  host::setWakeupCause(ESP_SLEEP_WAKEUP_UNDEFINED);
+  FastWake::save(1000, FastWake::NO_WAKE_PIN, false);
+  host::setWakeupCause(ESP_SLEEP_WAKEUP_TIMER);
+  delay(400);
+
+  FastWake::State state;
+  unsigned long remaining = 0;
+  assertFalse(FastWake::workDue(state, remaining));
+  assertEqual(600UL, remaining);
+
+  // The stand-in returns from deep sleep once the rest of the period has passed
   unsigned long start = millis();
-  while (millis() - start < ms) {
+  ESPLowPowerSensor::sleepIfIdle();
+  assertEqual(600UL, millis() - start);
+  assertTrue(FastWake::workDue(state, remaining));
+
+  host::setWakeupCause(ESP_SLEEP_WAKEUP_UNDEFINED);
+}
+
+test(sleepIfIdle_returns_for_due_wake) {
+  host::setWakeupCause(ESP_SLEEP_WAKEUP_UNDEFINED);
+  FastWake::save(1000, FastWake::NO_WAKE_PIN, false);
+  host::setWakeupCause(ESP_SLEEP_WAKEUP_TIMER);
+  delay(1000 - ESP_LOW_POWER_SENSOR_WAKE_TOLERANCE_MS);
+
+  unsigned long start = millis();
+  ESPLowPowerSensor::sleepIfIdle();
+  assertEqual(0UL, millis() - start);
+
+  // Power-on is always due, whatever was recorded
+  host::setWakeupCause(ESP_SLEEP_WAKEUP_UNDEFINED);
+  FastWake::State state;
+  unsigned long remaining = 0;
+  assertTrue(FastWake::workDue(state, remaining));
+}
+
+test(deepSleepWake_resumes_remaining_period) {
+  host::setWakeupCause(ESP_SLEEP_WAKEUP_UNDEFINED);
+  FastWake::save(10000, FastWake::NO_WAKE_PIN, false);
+  host::setWakeupCause(ESP_SLEEP_WAKEUP_TIMER);
+  delay(4000);
+
+  // setup() after the wake; the first run() sleeps out the rest of the period
+  int count = 0;
+  ESPLowPowerSensor sensor;
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::SINGLE_INTERVAL, false, ESPLowPowerSensor::LowPowerMode::DEEP_SLEEP));
+  sensor.clearPersistedConfig();
+  assertTrue(sensor.addSensor([&count](){ count++; }, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 10000));
+  unsigned long start = millis();
+  sensor.run();
+  assertEqual(0, count);
+  assertEqual(6000UL, millis() - start);
+
+  // The next run() is the end of the original period
+  sensor.run();
+  assertEqual(1, count);
+
+  host::setWakeupCause(ESP_SLEEP_WAKEUP_UNDEFINED);
+}
+#endif
+
+// Trace recorder
+
+test(trace_ring_keeps_newest_events) {
+  TraceRecorder::setEnabled(true);
+  TraceRecorder::clear();
+
+  const size_t capacity = TraceRecorder::capacity();
+  for (size_t i = 0; i < capacity + 3; i++) {
+    TraceRecorder::record(TraceRecorder::EventType::DISPATCH_BEGIN, 0, i);
+  }
+  assertEqual(capacity, TraceRecorder::size());
+
+  TraceRecorder::Event event;
+  assertTrue(TraceRecorder::read(0, event));
+  assertEqual(3U, (unsigned) event.arg16);
+  assertTrue(TraceRecorder::read(capacity - 1, event));
+  assertEqual((unsigned) (capacity + 2), (unsigned) event.arg16);
+
+  // A buffer for two events gets the newest two
+  uint8_t buffer[8 + 2 * sizeof(TraceRecorder::Event)];
+  assertEqual(sizeof(buffer), TraceRecorder::serialize(buffer, sizeof(buffer)));
+  assertEqual(2U, (unsigned) buffer[6]);
+  assertEqual((unsigned) ((capacity + 1) & 0xFF), (unsigned) buffer[8 + 6]);
+
+  TraceRecorder::setEnabled(false);
+  TraceRecorder::record(TraceRecorder::EventType::DISPATCH_BEGIN);
+  assertEqual(capacity, TraceRecorder::size());
+}
+
+// Uplink schedule
+
+test(uplinkSchedule_slots_and_backoff) {
+  UplinkSchedule::Config config = UplinkSchedule::defaults();
+  config.slotCount = 4;
+  UplinkSchedule schedule(config);
+
+  // Nodes 0 to 3 get distinct slots a quarter of the interval apart
+  for (uint32_t id = 0; id < 4; id++) {
+    schedule.setNodeId(id);
+    assertEqual(id * 15000UL, schedule.slotOffset(60000));
+  }
+
+  // Backoff limits double from the base up to the cap
+  schedule.seed(42);
+  for (int i = 0; i < 50; i++) {
+    assertTrue(schedule.backoffDelay(0) <= config.backoffBaseMs);
+    assertTrue(schedule.backoffDelay(10) <= config.backoffMaxMs);
+    assertTrue(schedule.cycleJitter(60000) <= 60000UL * config.jitterPercent / 100);
+  }
+}
+
+#if defined(HOST_ARDUINO_H)
+// Needs the host stand-in, whose deep sleep returns after the sleep time
+test(uplinkStagger_jitter_does_not_accumulate) {
+  unsigned long executedAt = 0;
+  ESPLowPowerSensor sensor;
+  sensor.enableUplinkStagger();
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::SINGLE_INTERVAL, false, ESPLowPowerSensor::LowPowerMode::DEEP_SLEEP));
+  sensor.clearPersistedConfig();
+  assertTrue(sensor.addSensor([&executedAt](){ executedAt = millis(); }, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 60000));
+
+  // The first run() sleeps until the slot; every cycle after it starts within
+  // the jitter of its slot, however many cycles have passed
+  sensor.run();
+  unsigned long slot = millis();
+  for (unsigned long cycle = 0; cycle < 200; cycle++) {
     sensor.run();
-    delay(1);
+    assertTrue(executedAt - (slot + cycle * 60000UL) <= 1200UL);
   }
-}
\ No newline at end of file
+}
+
+test(deepSleepWake_keeps_jittered_cycle_on_slot) {
+  // The last sleep ran 150 ms past the end of the period
+  host::setWakeupCause(ESP_SLEEP_WAKEUP_UNDEFINED);
+  FastWake::save(10150, FastWake::NO_WAKE_PIN, false, 150);
+  host::setWakeupCause(ESP_SLEEP_WAKEUP_TIMER);
+  delay(10150);
+
+  int count = 0;
+  ESPLowPowerSensor sensor;
+  sensor.enableUplinkStagger();
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::SINGLE_INTERVAL, false, ESPLowPowerSensor::LowPowerMode::DEEP_SLEEP));
+  sensor.clearPersistedConfig();
+  assertTrue(sensor.addSensor([&count](){ count++; }, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 10000));
+
+  // The next period is timed from the slot, 150 ms before this wake
+  unsigned long start = millis();
+  sensor.run();
+  assertEqual(1, count);
+  assertTrue(millis() - start >= 9850UL);
+  assertTrue(millis() - start <= 9850UL + 200UL);
+
+  host::setWakeupCause(ESP_SLEEP_WAKEUP_UNDEFINED);
+}
+
+// Needs the host stand-in to slow down association
+test(uplinkSchedule_default_connect_is_one_long_attempt) {
+  WiFi.disconnect(true);
+  WiFi.connectDelayMs = 5000;
+
+  // The default waits as long as the library always did
+  ESPLowPowerSensor sensor;
+  sensor.setWiFiCredentials("ssid", "password");
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, true, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+  WiFi.disconnect(true);
+
+  // Short attempts start association over each time
+  UplinkSchedule::Config config = UplinkSchedule::defaults();
+  config.attemptTimeoutMs = 3000;
+  config.maxAttempts = 3;
+  ESPLowPowerSensor shortAttempts;
+  shortAttempts.setWiFiCredentials("ssid", "password");
+  shortAttempts.setUplinkSchedule(config);
+  assertFalse(shortAttempts.initialize(ESPLowPowerSensor::Mode::PER_SENSOR, true, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+
+  WiFi.connectDelayMs = 0;
+}
+#endif
+
+// Report link
+
+test(reportLink_batches_and_retries) {
+  LoopbackTransport loopback;
+  ReportLink link;
+  link.setTransport(&loopback);
+  link.setNodeId(7);
+  loopback.begin();
+
+  // Three reports travel in one frame
+  const uint8_t reading[] = {1, 2, 3};
+  for (int i = 0; i < 3; i++) {
+    assertTrue(link.queue(reading, sizeof(reading)));
+  }
+  assertTrue(link.flush());
+  assertEqual(1UL, (unsigned long) loopback.framesReceived());
+  assertEqual(3UL, (unsigned long) loopback.recordsReceived());
+
+  // A lost frame is resent
+  loopback.dropFrames = 1;
+  assertTrue(link.queue(reading, sizeof(reading)));
+  assertTrue(link.flush());
+  assertEqual(1UL, (unsigned long) link.stats().retries);
+
+  // A resend after a lost ack is acknowledged but not kept twice
+  loopback.dropAcks = 1;
+  assertTrue(link.queue(reading, sizeof(reading)));
+  assertTrue(link.flush());
+  assertEqual(3UL, (unsigned long) loopback.framesReceived());
+  assertEqual(1UL, (unsigned long) loopback.duplicates());
+
+  // Nothing gets through: the frame stays queued
+  loopback.dropFrames = 255;
+  assertTrue(link.queue(reading, sizeof(reading)));
+  assertFalse(link.flush());
+  assertEqual(1UL, (unsigned long) link.pending());
+  loopback.dropFrames = 0;
+  assertTrue(link.flush());
+
+  // The gateway has a frame whose acks were all lost; a report queued after
+  // it goes out in a new frame instead of being dropped as a resend
+  loopback.dropAcks = 255;
+  assertTrue(link.queue(reading, sizeof(reading)));
+  assertFalse(link.flush());
+  assertEqual(5UL, (unsigned long) loopback.framesReceived());
+  loopback.dropAcks = 0;
+  const uint8_t later[] = {4, 5};
+  assertTrue(link.queue(later, sizeof(later)));
+  assertTrue(link.flush());
+  assertEqual(6UL, (unsigned long) loopback.framesReceived());
+  size_t length;
+  const uint8_t* last = loopback.lastRecord(length);
+  assertEqual(sizeof(later), length);
+  assertEqual(4, (int) last[0]);
+}
+
+#if defined(HOST_ARDUINO_H)
+// Needs the host stand-in for deep sleep and WiFi association time
+test(report_over_loopback_before_deep_sleep) {
+  host::setWakeupCause(ESP_SLEEP_WAKEUP_UNDEFINED);
+  WiFi.disconnect(true);
+  WiFi.connectDelayMs = 2500;
+  const uint8_t reading[] = {42};
+
+  // The same cycle over WiFi keeps the radio on for the association
+  uint64_t wifiBefore = WiFi.radioOnMicros();
+  ESPLowPowerSensor wifiNode;
+  wifiNode.setWiFiCredentials("ssid", "password");
+  assertTrue(wifiNode.initialize(ESPLowPowerSensor::Mode::SINGLE_INTERVAL, true, ESPLowPowerSensor::LowPowerMode::DEEP_SLEEP));
+  wifiNode.clearPersistedConfig();
+  assertTrue(wifiNode.addSensor([](){}, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 60000));
+  wifiNode.run();
+  assertTrue(WiFi.radioOnMicros() - wifiBefore >= 2500000ULL);
+  WiFi.disconnect(true);  // The stand-in's deep sleep returns and reconnects
+
+  // Over the loopback the report is sent and acknowledged as the node goes to sleep
+  host::setWakeupCause(ESP_SLEEP_WAKEUP_UNDEFINED);
+  wifiBefore = WiFi.radioOnMicros();
+  LoopbackTransport loopback;
+  ESPLowPowerSensor sensor;
+  sensor.setTransport(&loopback);
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::SINGLE_INTERVAL, true, ESPLowPowerSensor::LowPowerMode::DEEP_SLEEP));
+  assertTrue(sensor.addSensor([&sensor, &reading]() { sensor.report(reading, sizeof(reading)); }, nullptr,
+                              ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 60000));
+  sensor.run();
+  assertEqual(1UL, (unsigned long) loopback.recordsReceived());
+  assertEqual(1UL, (unsigned long) sensor.getReportStats().framesDelivered);
+  assertTrue(loopback.radioOnMs() <= 5);
+  assertTrue(WiFi.radioOnMicros() == wifiBefore);
+
+  // A frame the gateway never acknowledges is counted lost at sleep
+  loopback.dropFrames = 255;
+  sensor.run();
+  assertEqual(1UL, (unsigned long) sensor.getReportStats().framesLost);
+  assertEqual(1UL, (unsigned long) loopback.recordsReceived());
+
+  WiFi.connectDelayMs = 0;
+  host::setWakeupCause(ESP_SLEEP_WAKEUP_UNDEFINED);
+}
+#endif
+
+// Uplink function
+
+test(uplinkFunction_runs_once_after_sensors) {
+  static int sensorRuns;
+  static int uplinkCalls;
+  static int sensorsBeforeUplink;
+  sensorRuns = uplinkCalls = sensorsBeforeUplink = 0;
+
+  ESPLowPowerSensor sensor;
+  sensor.enablePipelining();
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::SINGLE_INTERVAL, false, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+  sensor.addSensor([]() { sensorRuns++; }, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 100);
+  sensor.addSensor([]() { sensorRuns++; }, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 100);
+  sensor.setUplinkFunction([]() { uplinkCalls++; sensorsBeforeUplink = sensorRuns; });
+
+  // Without WiFi required the uplink runs right after the last sensor
+  delay(100);
+  sensor.run();
+  assertEqual(2, sensorRuns);
+  assertEqual(1, uplinkCalls);
+  assertEqual(2, sensorsBeforeUplink);
+}
+
+#if defined(HOST_ARDUINO_H)
+// Needs the host stand-in to slow down association
+test(pipelinedCycle_overlaps_association_with_sensors) {
+  static int sensorRuns;
+  static int uplinkCalls;
+  static bool connectedAtUplink;
+  static unsigned long uplinkAt;
+  sensorRuns = uplinkCalls = 0;
+  connectedAtUplink = false;
+  WiFi.disconnect(true);
+  WiFi.connectDelayMs = 500;
+
+  ESPLowPowerSensor sensor;
+  sensor.setWiFiCredentials("ssid", "password");
+  sensor.enablePipelining();
+  assertTrue(sensor.initialize(ESPLowPowerSensor::Mode::SINGLE_INTERVAL, true, ESPLowPowerSensor::LowPowerMode::LIGHT_SLEEP));
+  assertTrue(WiFi.status() != WL_CONNECTED);
+  for (int i = 0; i < 3; i++) {
+    sensor.addSensor([]() { delay(300); sensorRuns++; }, nullptr, ESPLowPowerSensor::TriggerMode::TIME_INTERVAL, 60000);
+  }
+  sensor.setUplinkFunction([]() {
+    uplinkCalls++;
+    uplinkAt = millis();
+    connectedAtUplink = WiFi.status() == WL_CONNECTED;
+  });
+
+  // Association finishes during the second sensor; the uplink still runs
+  // once, after the third, 900 ms in rather than 500 + 900 ms
+  delay(60000);
+  unsigned long start = millis();
+  sensor.run();
+  assertEqual(3, sensorRuns);
+  assertEqual(1, uplinkCalls);
+  assertTrue(connectedAtUplink);
+  assertEqual(900UL, uplinkAt - start);
+
+  WiFi.disconnect(true);
+  WiFi.connectDelayMs = 0;
+}
+#endif